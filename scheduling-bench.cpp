@@ -0,0 +1,131 @@
+#include <climits>
+#include "scheduling.h"
+
+/* the microbenchmark of the scheduler's core operations on each kind of queue level, at 1K, 100K and 10M
+   processes queued (or at the comma-separated numbers given as the first argument, for the comma-separated
+   policies given as the second): enqueueing an arriving process, dispatching the next process and handling
+   the end of its slice, and upgrading a process by aging; each is timed over many operations, with the
+   queues kept at the given size, and reported as the mean time per operation */
+
+#define BENCH_POLICIES "rr,fcfs,sjf,srtf,prio,edf,cfs,lottery,stride"   /* the policies benchmarked */
+#define BENCH_QUANTUM 10                 /* the time quantum, and the longest any process runs at a time */
+#define BENCH_DISPATCHES 1000000         /* the number of dispatches timed at each size */
+#define BENCH_AGINGS 1000000             /* the most upgrades timed at each size */
+
+/* the two groups that the processes are split between, so that the CPU is always contended */
+GroupTree benchGroups() {
+  GroupTree t;
+  t.parse("other=1");
+  return t;
+}
+
+static const GroupTree groups = benchGroups();
+
+/* a process with a burst far longer than it can run for during the benchmark, so that it never finishes,
+   starting in the given level, in either group, with random keys for the policies that order their
+   processes */
+Process benchProcess(Rng& rng, int id, int level) {
+  Process p;
+  p.id = id;
+  p.group = (id % 2 == 0) ? DEFAULT_GROUP : groups.find("other");
+  p.initQueueLevel = level;
+  p.currQueueLevel = level;
+  p.burstTime = 1000000000 + (int) (rng.next() % 1000000);
+  p.arrivalTime = (double) (rng.next() % 1000000);
+  p.deadline = 1e12 + (double) (rng.next() % 1000000000);
+  p.weight = 1 << (rng.next() % 3);
+  p.tickets = 1 + (uint32_t) (rng.next() % 400);
+  return p;
+}
+
+/* a scheduler on one CPU with two levels following policy, whose slices are all capped at the quantum, as
+   the two groups always compete, so that processes go back into the queues rather than run to the end of
+   their bursts, and the queues stay at the size they are filled to */
+Scheduler* benchScheduler(const std::string& policy) {
+  std::vector <AnyLevel> levels = parseLevels((policy + "," + policy).c_str(), BENCH_QUANTUM);
+  Scheduler* sched = new Scheduler(levels, 1, 0, 0, 1, NULL);
+  sched->setGroups(&groups, BENCH_QUANTUM);
+  sched->threshold = LONG_MAX;
+  return sched;
+}
+
+/* to time the operations on levels following policy with n processes queued, printing the time each took */
+void bench(const std::string& policy, long n) {
+  Rng rng;
+  rng.seed(n);
+  long i;
+
+  /* enqueueing: adding the processes to the table and the first level of the CPU */
+  Scheduler* sched = benchScheduler(policy);
+  double start = wallTime();
+  for (i = 0; i < n; i++) {
+    Process p = benchProcess(rng, i + 1, 1);
+    sched->enqueue(0, sched->procs.add(p));
+  }
+  double enqueueTime = wallTime() - start;
+
+  /* dispatching: picking the next process to run from the first level, and putting it back at the end of
+     its slice */
+  start = wallTime();
+  for (i = 0; i < BENCH_DISPATCHES; i++) {
+    sched->step(INFINITY);
+  }
+  double dispatchTime = wallTime() - start;
+  delete sched;
+
+  /* aging: with the processes in the second level having joined it 1 ms apart, moving the clock on 1 ms
+     at a time, so that each check upgrades the one process that has now waited past the threshold */
+  sched = benchScheduler(policy);
+  for (i = 0; i < n; i++) {
+    Process p = benchProcess(rng, i + 1, 2);
+    p.currArrivalTime = i;
+    sched->enqueue(0, sched->procs.add(p));
+  }
+  long agings = (n < BENCH_AGINGS) ? n : BENCH_AGINGS;
+  sched->threshold = 0;
+  start = wallTime();
+  for (i = 0; i < agings; i++) {
+    sched->clock.now = i + 0.5;
+    sched->checkThreshold(0);
+  }
+  double agingTime = wallTime() - start;
+  long promoted = sched->promotions;
+  delete sched;
+
+  fprintf(stdout, "Policy: %-8s; Queued: %-9ld; Enqueue: %8.1lf (ns/op); Dispatch: %8.1lf (ns/op); Aging: %8.1lf (ns/op, %ld upgraded)\n", policy.c_str(), n, (enqueueTime*1e6)/n, (dispatchTime*1e6)/BENCH_DISPATCHES, (promoted > 0) ? (agingTime*1e6)/promoted : 0, promoted);
+}
+
+int main(int argc, char* argv[]) {
+  const char* sizes = (argc > 1) ? argv[1] : "1000,100000,10000000";
+  const char* policies = (argc > 2) ? argv[2] : BENCH_POLICIES;
+  std::vector <long> ns;
+  char* buf = strdup(sizes);
+  char* save;
+  char* tok = strtok_r(buf, ",", &save);
+  while (tok != NULL) {
+    long n = atol(tok);
+    if (n < 1 || n >= NIL_HANDLE) {
+      std::cout << "Expected the number of processes queued to be positive, but received " << tok << "\n";
+      exit(0);
+    }
+    ns.push_back(n);
+    tok = strtok_r(NULL, ",", &save);
+  }
+  free(buf);
+  buf = strdup(policies);
+  tok = strtok_r(buf, ",", &save);
+  while (tok != NULL) {
+    AnyLevel level;
+    if (!makeLevel(tok, BENCH_QUANTUM, level)) {
+      std::cout << "Expected level policy to be one of " << BENCH_POLICIES << ", but received " << tok << "\n";
+      exit(0);
+    }
+    size_t k;
+    for (k = 0; k < ns.size(); k++) {
+      bench(tok, ns[k]);
+    }
+    tok = strtok_r(NULL, ",", &save);
+  }
+  free(buf);
+  return 0;
+}
@@ -1,192 +1,333 @@
-#include <cstdio>
-#include <iostream>
-#include <cstdlib>
-#include <cstring>
-#include <string>
-#include <queue>
-#include <sys/time.h>
-#include <unistd.h>
-
-class Process {
-  public:
-    int id;                     /* the process ID */
-    int initQueueLevel;         /* the level of the first queue the process was assigned to */
-    int currQueueLevel;         /* the level of the queue the process is currently in */
-    int burstTime;              /* the duration of the CPU burst for the process */
-    double arrivalTime;         /* the time at which the process first joined a queue */
-    double currArrivalTime;     /* the time at which the process joined the current queue */
-    double finishTime;          /* the time at which the process finished its CPU burst execution */
-};
+#include "scheduling.h"
 
-/* comparator used in the declaration of the priority queue (max heap by default) for the SJF queues */
-class Compare {
-  public:
-    bool operator() (Process p1, Process p2) {
-      if (p1.burstTime > p2.burstTime) {
-        return true;
-      }
-      else {
-        return false;
-      }
-    }
-};
-
-/* the multi-level feedback queues */
-std::queue <Process> q1;
-std::priority_queue <Process, std::vector<Process>, Compare> q2;
-std::priority_queue <Process, std::vector<Process>, Compare> q3;
-std::queue <Process> q4;
-
-/* global variables to store the start time and end time of the program */
-double st, et;
+#define MAX_REPLICAS 10000       /* the maximum number of replicas of a Monte Carlo run */
+#define REPLICA_METRICS 7        /* the number of metrics taken from every replica */
+#define REPLICA_JAIN 6           /* the metric that is Jain's fairness index */
 
 /* the input parameters from the command line */
 char* inputFileName;      /* the file containing the input parameters for the different processes */
+const char* workloadSpec; /* the settings of the synthetic workload to generate instead, if any */
 char* outputFileName;     /* the file into which the output logs should be printed */
+char* binaryLogFileName;  /* the file into which the processes that finish are logged in binary, if any */
+char* timelineFileName;   /* the file into which the timeline of scheduling decisions is written, if any */
+int converting = 0;       /* whether to convert the binary log in the input file into text, instead of scheduling */
 int tq;                   /* the time quantum for the Round Robin scheduling algorithm */
 long threshold;           /* the threshold time beyond which a process waiting in a lower queue
                              can be upgraded to the immediate higher queue */
+std::vector <long> quanta;        /* the time quanta to sweep over (just tq, outside a sweep) */
+std::vector <long> thresholds;    /* the thresholds to sweep over (just threshold, outside a sweep) */
+int simulated = 0;        /* whether the scheduler runs against a virtual clock (1) or the wall clock (0) */
+int executing = 0;        /* whether the processes are run for real on worker threads (1) */
+int numCpus = 1;          /* the number of CPUs that processes are scheduled on */
+int preemptive = 0;       /* whether a process joining a higher level preempts the running process (1) */
+std::vector <long> deviceTimes;   /* the service time of each simulated I/O device */
+CostModel costModel;      /* the cost of switching a CPU from one process to another */
+GroupTree groupTree;      /* the groups that processes are scheduled on behalf of */
+int grouped = 0;          /* whether groups were given (1), so that the CPU is shared out between them */
+QuantumTuner quantumTuner;        /* the controller of the first level's time quantum, if it is adaptive */
+char* checkpointFileName; /* the file into which snapshots of the scheduler are saved, if any */
+double checkpointEvery = 0;       /* how often (ms of simulated time) a snapshot is saved */
+char* resumeFileName;     /* the snapshot that the scheduler picks up from, if any */
+Topology topology;        /* the layout of the CPUs into nodes, and how processes are placed on them */
+int numReplicas = 0;      /* the number of independent replicas of the workload to simulate (0 for one plain run) */
+uint64_t runSeed = 1;     /* the seed of the run, which lottery levels draw from (the generator's, if it is used) */
+const char* levelSpec = "rr,sjf,sjf,fcfs";   /* the policies of the queue levels, from highest to lowest, each
+                                               optionally followed by :quantum (default tq) */
+
+
+/* to parse a list of parameter values, each in the range lo - hi: either a single value, a comma-separated
+   list of values, or a range first:last[:step] (step 1 by default) */
+std::vector <long> parseValues(const char* spec, long lo, long hi, const char* what) {
+  std::vector <long> values;
+  if (strchr(spec, ':') != NULL) {
+    long first = 0, last = 0, step = 1;
+    if (sscanf(spec, "%ld:%ld:%ld", &first, &last, &step) < 2 || step <= 0 || last < first) {
+      std::cout << "Expected " << what << " range to be first:last[:step] with first <= last and step > 0, but received " << spec << "\n";
+      exit(0);
+    }
+    long v;
+    for (v = first; v <= last; v += step) {
+      values.push_back(v);
+    }
+  }
+  else {
+    const char* ptr = spec;
+    while (*ptr != '\0') {
+      values.push_back(atol(ptr));
+      ptr += strcspn(ptr, ",");
+      if (*ptr == ',') {
+        ptr++;
+      }
+    }
+  }
+  size_t i;
+  for (i = 0; i < values.size(); i++) {
+    if (values[i] < lo || values[i] > hi) {
+      std::cout << "Expected " << what << " value to be in the range " << lo << " - " << hi << ", but received " << values[i] << "\n";
+      exit(0);
+    }
+  }
+  return values;
+}
+
+/* the outcome of one configuration of a parameter sweep */
+class SweepResult {
+  public:
+    int quantum;          /* the time quantum of the configuration */
+    long threshold;       /* the threshold of the configuration */
+    int numProc;          /* the number of processes scheduled */
+    double meanTat;       /* the mean TAT */
+    double throughput;    /* the throughput, in processes/sec */
+    double makespan;      /* the time at which the last process finished */
+    long promotions;      /* the number of aging upgrades */
+    long migrations;      /* the number of processes moved between CPUs */
+    double p99Tat;        /* the 99th percentile TAT */
+    double overhead;      /* the percentage of CPU time spent switching between processes */
+    double jain;          /* Jain's fairness index of the shares of the CPU the processes got */
+};
+
+/* to simulate every combination of the given time quanta and thresholds on the same processes, spreading
+   the configurations over a thread per hardware CPU, and to log one CSV row per configuration */
+void runSweep(const std::vector<Process>& procs, const std::vector<long>& quanta, const std::vector<long>& thresholds, FILE* fp) {
+  std::vector <SweepResult> results(quanta.size()*thresholds.size());
+  std::atomic <size_t> nextConfig(0);
+
+  /* each thread repeatedly takes the next configuration that no thread has taken yet */
+  auto worker = [&]() {
+    size_t k;
+    while ((k = nextConfig.fetch_add(1)) < results.size()) {
+      SweepResult& r = results[k];
+      r.quantum = quanta[k / thresholds.size()];
+      r.threshold = thresholds[k % thresholds.size()];
+      Scheduler sched(parseLevels(levelSpec, r.quantum), numCpus, r.threshold, preemptive, 1, NULL);
+      sched.addDevices(deviceTimes);
+      sched.cost = costModel;
+      sched.topo = topology;
+      sched.setGroups(&groupTree, grouped ? r.quantum : 0);
+      sched.setSeed(runSeed);
+      ProcessList list(&procs);
+      sched.addProcessesToQueue(&list);
+      sched.run();
+      r.numProc = sched.numProc;
+      r.meanTat = sched.sumTat/sched.numProc;
+      r.throughput = (sched.numProc*1000.0)/sched.makespan;
+      r.makespan = sched.makespan;
+      r.promotions = sched.promotions;
+      r.migrations = sched.migrations;
+      r.p99Tat = sched.latency.of(LAT_TAT, 0).percentile(0.99);
+      double busyTime = 0, switchTime = 0;
+      int c;
+      for (c = 0; c < numCpus; c++) {
+        busyTime += sched.cores[c].busyTime;
+        switchTime += sched.cores[c].switchTime + sched.cores[c].refillTime;
+      }
+      r.overhead = (busyTime > 0) ? (100.0*switchTime)/busyTime : 0;
+      r.jain = sched.latency.jain(0);
+    }
+  };
 
-/* to print the elements of a queue */
-void printQueue(std::queue <Process> q) {
-  while (!q.empty()) {
-    std::cout << q.front().id << " " << q.front().initQueueLevel << " " << q.front().burstTime << "\n";
-    q.pop();
+  int numThreads = std::thread::hardware_concurrency();
+  if (numThreads < 1) {
+    numThreads = 1;
+  }
+  if (numThreads > (int) results.size()) {
+    numThreads = results.size();
+  }
+  std::vector <std::thread> threads;
+  int t;
+  for (t = 0; t < numThreads; t++) {
+    threads.push_back(std::thread(worker));
+  }
+  for (t = 0; t < numThreads; t++) {
+    threads[t].join();
+  }
+
+  fprintf(fp, "quantum,threshold,processes,mean_tat_ms,throughput_per_sec,makespan_ms,promotions,migrations,p99_tat_ms,overhead_pct,jain_index\n");
+  fprintf(stdout, "quantum,threshold,processes,mean_tat_ms,throughput_per_sec,makespan_ms,promotions,migrations,p99_tat_ms,overhead_pct,jain_index\n");
+  size_t k;
+  for (k = 0; k < results.size(); k++) {
+    SweepResult& r = results[k];
+    fprintf(fp, "%d,%ld,%d,%.2lf,%.2lf,%.2lf,%ld,%ld,%.2lf,%.2lf,%.4lf\n", r.quantum, r.threshold, r.numProc, r.meanTat, r.throughput, r.makespan, r.promotions, r.migrations, r.p99Tat, r.overhead, r.jain);
+    fprintf(stdout, "%d,%ld,%d,%.2lf,%.2lf,%.2lf,%ld,%ld,%.2lf,%.2lf,%.4lf\n", r.quantum, r.threshold, r.numProc, r.meanTat, r.throughput, r.makespan, r.promotions, r.migrations, r.p99Tat, r.overhead, r.jain);
   }
-  std::cout << "\n";
 }
 
-/* to print the elements of a priority queue */
-void printPQueue(std::priority_queue <Process, std::vector<Process>, Compare> q) {
-  while (!q.empty()) {
-    std::cout << q.top().id << " " << q.top().initQueueLevel << " " << q.top().burstTime << "\n";
-    q.pop();
+/* the metrics of one replica of a Monte Carlo run */
+class ReplicaResult {
+  public:
+    int numProc;          /* the number of processes scheduled */
+    double v[REPLICA_METRICS];   /* the value of each metric, as named in replicaMetrics */
+};
+
+/* the names of the metrics that are taken from every replica */
+const char* replicaMetrics[REPLICA_METRICS] = {"Mean TAT(ms)", "p50 TAT(ms)", "p99 TAT(ms)", "Mean Response(ms)", "p99 Response(ms)", "Throughput(/sec)", "Jain's Index"};
+
+/* the critical value of Student's t distribution with df degrees of freedom, for a two-sided 95% confidence
+   interval; past 30, interpolated linearly in 1/df between the values at 30, 40, 60, 120 and infinity (that
+   of the normal distribution), which is within 0.001 of the exact value */
+double tCritical95(int df) {
+  static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  static const double tailDf[5] = {30, 40, 60, 120, INFINITY};
+  static const double tail[5] = {2.042, 2.021, 2.000, 1.980, 1.960};
+  if (df <= 30) {
+    return table[df - 1];
+  }
+  int k = 1;
+  while (df > tailDf[k]) {
+    k++;
   }
-  std::cout << "\n";
+  double f = (1.0/tailDf[k - 1] - 1.0/df)/(1.0/tailDf[k - 1] - 1.0/tailDf[k]);
+  return tail[k - 1] + f*(tail[k] - tail[k - 1]);
 }
 
-/* to read the information about different processes from the input file, and store them
-   in the corresponding queues */
-void addProcessesToQueue() {
-  FILE* fp;
-  fp = fopen(inputFileName, "r");
-
-  /* checking for any error in opening the file */
-  if (fp == NULL) {
-    printf("Error in opening file %s\n", inputFileName);
-    exit(1);
-  }
-
-  char delim[] = " \t";
-  char line[100];
-  /* reading from file */
-  while (fgets(line, 100, fp) != NULL) {
-    int arr[3];
-    int i = 0;
-    /* using strtok to store the different fields of the process in an array */
-    char *ptr = strtok(line, delim);
-    while (ptr != NULL) {
-      arr[i] = atoi(ptr);
-      i++;
-      ptr = strtok(NULL, delim);
-    }
-    /* creating a Process object using the parameters stored in the array */
-    Process p;
-    p.id = arr[0];
-    p.initQueueLevel = arr[1];
-    p.currQueueLevel = arr[1];
-    p.burstTime = arr[2];
-    p.arrivalTime = 0;
-    p.currArrivalTime = 0;
-    /* adding the Process to the corresponding queue */
-    switch (arr[1]) {
-      case 1:
-            q1.push(p);
-            break;
-      case 2:
-            q2.push(p);
-            break;
-      case 3:
-            q3.push(p);
-            break;
-      case 4:
-            q4.push(p);
-            break;
-      default:
-            std::cout << "Invalid\n";
-            exit(0);
+/* to draw a replica of the processes read from the input file by resampling them with replacement: each
+   process of the replica is a copy of one picked at random, arriving after a gap picked at random from the
+   gaps between arrivals in the file */
+std::vector <Process> resample(const std::vector<Process>& procs, uint64_t seed) {
+  Rng rng;
+  rng.seed(seed);
+  std::vector <Process> out(procs.size());
+  double now = procs[0].arrivalTime;
+  size_t i;
+  for (i = 0; i < procs.size(); i++) {
+    const Process& from = procs[rng.next() % procs.size()];
+    if (i > 0) {
+      size_t g = 1 + rng.next() % (procs.size() - 1);
+      now += procs[g].arrivalTime - procs[g - 1].arrivalTime;
+    }
+    Process& p = out[i];
+    p = from;
+    p.id = i + 1;
+    p.arrivalTime = now;
+    p.currArrivalTime = now;
+    if (from.deadline != INFINITY) {
+      p.deadline = now + (from.deadline - from.arrivalTime);
     }
   }
-  fclose(fp);
+  return out;
 }
 
-/* to check whether any of the processes at the heads of the queues 2,3,4 have been waiting
-   for more time than the threshold time, since their arrival into their respective queues */
-void checkThreshold() {
-  Process p;
-  double tempT;
-  struct timeval temp_time;
-  gettimeofday(&temp_time, NULL);
-  tempT = (temp_time.tv_sec * 1000000 + temp_time.tv_usec +0.0)/1000;
-
-  if (!q2.empty()) {
-    p = q2.top();
-    if (tempT - p.currArrivalTime - st > threshold) {
-      q2.pop();
-      p.currArrivalTime = tempT;
-      p.currQueueLevel = 1;
-      q1.push(p);
+/* to simulate numReplicas independent replicas of the workload, spreading them over a thread per hardware
+   CPU, and to log one CSV row per replica followed by the mean of each metric over the replicas with its
+   95% confidence interval; replica r of a generated workload uses the seed r after the one given, and
+   replica r of the input file resamples it with the seed r + 1; the lottery levels of replica r draw from the
+   seed r after the run's */
+void runReplicas(int numReplicas, WorkloadGenerator* gen, const std::vector<Process>& procs, FILE* fp) {
+  std::vector <ReplicaResult> results(numReplicas);
+  std::atomic <int> nextReplica(0);
+
+  /* each thread repeatedly takes the next replica that no thread has taken yet */
+  auto worker = [&]() {
+    int r;
+    while ((r = nextReplica.fetch_add(1)) < numReplicas) {
+      Scheduler sched(parseLevels(levelSpec, tq), numCpus, threshold, preemptive, 1, NULL);
+      sched.addDevices(deviceTimes);
+      sched.cost = costModel;
+      sched.topo = topology;
+      sched.tuner = quantumTuner;
+      sched.setGroups(&groupTree, grouped ? tq : 0);
+      sched.setSeed(runSeed + r);
+      WorkloadGenerator replicaGen;
+      std::vector <Process> replicaProcs;
+      ProcessList list(&replicaProcs);
+      if (gen != NULL) {
+        replicaGen = *gen;
+        replicaGen.reseed(r);
+        sched.addProcessesToQueue(&replicaGen);
+      }
+      else {
+        replicaProcs = resample(procs, r + 1);
+        sched.addProcessesToQueue(&list);
+      }
+      sched.run();
+      ReplicaResult& res = results[r];
+      res.numProc = sched.numProc;
+      res.v[0] = sched.sumTat/sched.numProc;
+      res.v[1] = sched.latency.of(LAT_TAT, 0).percentile(0.5);
+      res.v[2] = sched.latency.of(LAT_TAT, 0).percentile(0.99);
+      res.v[3] = sched.latency.of(LAT_RESPONSE, 0).sum/sched.numProc;
+      res.v[4] = sched.latency.of(LAT_RESPONSE, 0).percentile(0.99);
+      res.v[5] = (sched.numProc*1000.0)/sched.makespan;
+      res.v[REPLICA_JAIN] = sched.latency.jain(0);
     }
+  };
+
+  int numThreads = std::thread::hardware_concurrency();
+  if (numThreads < 1) {
+    numThreads = 1;
+  }
+  if (numThreads > numReplicas) {
+    numThreads = numReplicas;
+  }
+  std::vector <std::thread> threads;
+  int t;
+  for (t = 0; t < numThreads; t++) {
+    threads.push_back(std::thread(worker));
+  }
+  for (t = 0; t < numThreads; t++) {
+    threads[t].join();
   }
 
-  if (!q3.empty()) {
-    p = q3.top();
-    if (tempT - p.currArrivalTime - st > threshold) {
-      q3.pop();
-      p.currArrivalTime = tempT;
-      p.currQueueLevel = 2;
-      q2.push(p);
-    }
+  fprintf(fp, "replica,processes,mean_tat_ms,p50_tat_ms,p99_tat_ms,mean_response_ms,p99_response_ms,throughput_per_sec,jain_index\n");
+  fprintf(stdout, "replica,processes,mean_tat_ms,p50_tat_ms,p99_tat_ms,mean_response_ms,p99_response_ms,throughput_per_sec,jain_index\n");
+  int r;
+  for (r = 0; r < numReplicas; r++) {
+    ReplicaResult& res = results[r];
+    fprintf(fp, "%d,%d,%.2lf,%.2lf,%.2lf,%.2lf,%.2lf,%.2lf,%.4lf\n", r, res.numProc, res.v[0], res.v[1], res.v[2], res.v[3], res.v[4], res.v[5], res.v[6]);
+    fprintf(stdout, "%d,%d,%.2lf,%.2lf,%.2lf,%.2lf,%.2lf,%.2lf,%.4lf\n", r, res.numProc, res.v[0], res.v[1], res.v[2], res.v[3], res.v[4], res.v[5], res.v[6]);
   }
 
-  if (!q4.empty()) {
-    p = q4.front();
-    if (tempT - p.currArrivalTime - st > threshold) {
-      q4.pop();
-      p.currArrivalTime = tempT;
-      p.currQueueLevel = 3;
-      q3.push(p);
+  /* the mean of each metric over the replicas, with the half-width of its confidence interval from the
+     spread of the replicas (none with a single replica) */
+  int m;
+  for (m = 0; m < REPLICA_METRICS; m++) {
+    double sum = 0, lo = results[0].v[m], hi = results[0].v[m];
+    for (r = 0; r < numReplicas; r++) {
+      sum += results[r].v[m];
+      lo = (results[r].v[m] < lo) ? results[r].v[m] : lo;
+      hi = (results[r].v[m] > hi) ? results[r].v[m] : hi;
+    }
+    double mean = sum/numReplicas;
+    double sq = 0;
+    for (r = 0; r < numReplicas; r++) {
+      sq += (results[r].v[m] - mean)*(results[r].v[m] - mean);
+    }
+    double sd = (numReplicas > 1) ? sqrt(sq/(numReplicas - 1)) : 0;
+    double half = (numReplicas > 1) ? tCritical95(numReplicas - 1)*sd/sqrt(numReplicas) : 0;
+    double ciLo = mean - half, ciHi = mean + half;
+    /* Jain's index can't leave [0, 1], so neither can its interval */
+    if (m == REPLICA_JAIN) {
+      ciLo = (ciLo < 0) ? 0 : ciLo;
+      ciHi = (ciHi > 1) ? 1 : ciHi;
     }
+    fprintf(fp, "Replicas: %-4d; %-18s: Mean: %-9.4g; 95%% CI: %-9.4g - %-9.4g; Std Dev: %-9.4g; Min: %-9.4g; Max: %-9.4g\n", numReplicas, replicaMetrics[m], mean, ciLo, ciHi, sd, lo, hi);
+    fprintf(stdout, "Replicas: %-4d; %-18s: Mean: %-9.4g; 95%% CI: %-9.4g - %-9.4g; Std Dev: %-9.4g; Min: %-9.4g; Max: %-9.4g\n", numReplicas, replicaMetrics[m], mean, ciLo, ciHi, sd, lo, hi);
   }
 }
 
 /* the driver code, to take inputs from the user, and simulate a process scheduler's functionality */
 int main(int argc, char* argv[]) {
   /* taking the command line arguments from the user */
-  if (argc != 9) {
-    std::cout << "Incorrect number of command line arguments, expected 9, received " << argc << "\n";
+  if (argc < 5 || argc % 2 == 0) {
+    std::cout << "Incorrect number of command line arguments, expected option-value pairs, received " << argc << "\n";
     exit(0);
   }
 
   int i = 1;
   char opt;
-  while (i <= 7) {
+  while (i < argc) {
     opt = argv[i][1];
     switch (opt) {
       case 'Q':
-        tq = atoi(argv[i+1]);
-        if (tq < 10 || tq > 20) {
-          std::cout << "Expected time quantum value to be in the range 10 - 20, but received " << tq << "\n";
-          exit(0);
-        }
+        quanta = parseValues(argv[i+1], 10, 20, "time quantum");
+        tq = quanta[0];
         break;
 
       case 'T':
-        threshold = atoi(argv[i+1]);
-        if (threshold < 100 || threshold > 50000) {
-          std::cout << "Expected threshold value to be in the range 100 - 50000, but received " << threshold << "\n";
-          exit(0);
-        }
+        thresholds = parseValues(argv[i+1], 100, 50000, "threshold");
+        threshold = thresholds[0];
         break;
 
       case 'F':
@@ -199,6 +340,105 @@ int main(int argc, char* argv[]) {
         strcpy(outputFileName, argv[i+1]);
         break;
 
+      case 'M':
+        if (strcmp(argv[i+1], "sim") == 0) {
+          simulated = 1;
+        }
+        else if (strcmp(argv[i+1], "real") == 0) {
+          simulated = 0;
+        }
+        else if (strcmp(argv[i+1], "exec") == 0) {
+          executing = 1;
+        }
+        else if (strcmp(argv[i+1], "convert") == 0) {
+          converting = 1;
+        }
+        else {
+          std::cout << "Expected mode to be one of real, sim, exec, convert, but received " << argv[i+1] << "\n";
+          exit(0);
+        }
+        break;
+
+      case 'L':
+        levelSpec = argv[i+1];
+        break;
+
+      case 'B':
+        binaryLogFileName = argv[i+1];
+        break;
+
+      case 'G':
+        workloadSpec = argv[i+1];
+        break;
+
+      case 'J':
+        timelineFileName = argv[i+1];
+        break;
+
+      case 'S':
+        costModel.parse(argv[i+1]);
+        break;
+
+      case 'H':
+        groupTree.parse(argv[i+1]);
+        grouped = 1;
+        break;
+
+      case 'A':
+        quantumTuner.parse(argv[i+1]);
+        break;
+
+      case 'K': {
+        char* colon = strchr(argv[i+1], ':');
+        checkpointEvery = (colon != NULL) ? atof(argv[i+1]) : 0;
+        if (checkpointEvery <= 0 || colon[1] == '\0') {
+          std::cout << "Expected checkpoints to be given as MS:FILE, with MS positive, but received " << argv[i+1] << "\n";
+          exit(0);
+        }
+        checkpointFileName = colon + 1;
+        break;
+      }
+
+      case 'W':
+        resumeFileName = argv[i+1];
+        break;
+
+      case 'U':
+        topology.parse(argv[i+1]);
+        break;
+
+      case 'N':
+        numReplicas = atoi(argv[i+1]);
+        if (numReplicas < 1 || numReplicas > MAX_REPLICAS) {
+          std::cout << "Expected the number of replicas to be in the range 1 - " << MAX_REPLICAS << ", but received " << argv[i+1] << "\n";
+          exit(0);
+        }
+        break;
+
+      case 'D':
+        deviceTimes = parseValues(argv[i+1], 0, 1000000, "device service time");
+        if (deviceTimes.size() > MAX_DEVICES) {
+          std::cout << "Expected at most " << MAX_DEVICES << " devices, but received " << deviceTimes.size() << "\n";
+          exit(0);
+        }
+        break;
+
+      case 'C':
+        numCpus = atoi(argv[i+1]);
+        if (numCpus < 1 || numCpus > MAX_CPUS) {
+          std::cout << "Expected number of CPUs to be in the range 1 - " << MAX_CPUS << ", but received " << numCpus << "\n";
+          exit(0);
+        }
+        break;
+
+      case 'R':
+        preemptive = atoi(argv[i+1]);
+        if (preemptive != 0 && preemptive != 1) {
+          std::cout << "Expected preemption to be 0 or 1, but received " << argv[i+1] << "\n";
+          exit(0);
+        }
+        break;
+
       default:
         std::cout << "Incorrect option -" << opt << "\n";
         exit(0);
@@ -207,137 +447,421 @@ int main(int argc, char* argv[]) {
     i = i + 2;
   }
 
-  /* reading the process information from the input file, and storing them in the respective queues */
-  addProcessesToQueue();
+  /* in convert mode, only turning the binary log in the input file into text */
+  if (converting) {
+    if (inputFileName == NULL || outputFileName == NULL) {
+      std::cout << "Expected each of the options -F and -P to be specified\n";
+      exit(0);
+    }
+    FILE* in = fopen(inputFileName, "rb");
+    if (in == NULL) {
+      printf("Error in opening file %s\n", inputFileName);
+      exit(1);
+    }
+    FILE* out = fopen(outputFileName, "a+");
+    convertLog(in, out);
+    fclose(in);
+    fclose(out);
+    return 0;
+  }
+
+  if (tq == 0 || threshold == 0 || (inputFileName == NULL && workloadSpec == NULL) || outputFileName == NULL) {
+    std::cout << "Expected each of the options -Q, -T, -F (or -G) and -P to be specified\n";
+    exit(0);
+  }
+  if (topology.nodes > numCpus) {
+    std::cout << "Expected at most as many nodes as CPUs, but received " << topology.nodes << " nodes for " << numCpus << " CPUs\n";
+    exit(0);
+  }
 
   /* opening the output logs file */
   FILE* fp;
   fp = fopen(outputFileName, "a+");
 
-  Process p;
-
-  /* the total number of processes that need to be scheduled/run */
-  int num_proc = q1.size() + q2.size() + q3.size() + q4.size();
-
-  /* to store the sum of TATs, to compute mean TAT at the end */
-  double sum_tat = 0.0;
-
-  /* a variable to keep track of the total number of processes currently waiting to be scheduled/run */
-  int flag = num_proc;
-
-  struct timeval start_time, temp_time, end_time;
-
-  /* taking note of the start time of the program */
-  gettimeofday(&start_time, NULL);
-  st = (start_time.tv_sec * 1000000 + start_time.tv_usec + 0.0)/1000;
-
-  /* the process scheduler runs as long as there are processes left to be scheduled/run
-     on the CPU, and each time a process finishes its CPU burst */
-
-  /* while there are still processes left to be scheduled */
-  while (flag > 0) {
-    /* while there are processes in queue 1 (Round Robin) left to be scheduled */
-    while (!q1.empty()) {
-      p = q1.front();
-      q1.pop();
-      /* if the time quantum for RR is less than the burst time (left) for the process... */
-      if (tq < p.burstTime) {
-        /* ...the process "runs on the CPU" for time quantum duration */
-        usleep(tq*1000);
-        /* the process is pushed back onto the tail of the queue, with modified leftover burst time */
-        p.burstTime -= tq;
-        q1.push(p);
-        /* each time a process finishes its CPU burst, the scheduler checks if any processes
-           have been waiting for too long */
-        checkThreshold();
+  /* the processes that finish are logged from a background thread, as text into the output logs file,
+     or in binary into the -B file if there is one */
+  CompletionLog clog;
+  FILE* bfp = NULL;
+  if (binaryLogFileName != NULL) {
+    bfp = fopen(binaryLogFileName, "wb");
+    if (bfp == NULL) {
+      printf("Error in opening file %s\n", binaryLogFileName);
+      exit(1);
+    }
+  }
+
+  /* the processes either are read from the input file as they arrive, or are generated */
+  int numLevels = parseLevels(levelSpec, tq).size();
+  if (quantumTuner.on && !std::visit([](auto& level) { return level.timeSliced(); }, parseLevels(levelSpec, tq)[0])) {
+    std::cout << "Expected the first level to be time-sliced for its quantum to be adaptive\n";
+    exit(0);
+  }
+  TraceReader trace;
+  WorkloadGenerator gen;
+  ProcessSource* source;
+  if (workloadSpec != NULL) {
+    gen.init(workloadSpec, numLevels, deviceTimes.size(), &groupTree);
+    runSeed = gen.seed;
+    source = &gen;
+  }
+  else {
+    trace.open(inputFileName, numLevels, deviceTimes.size(), &groupTree);
+    source = &trace;
+  }
+
+  /* a snapshot is only bit for bit the same run when time is simulated */
+  if ((checkpointFileName != NULL || resumeFileName != NULL) && (!simulated || executing || quanta.size()*thresholds.size() > 1)) {
+    std::cout << "Checkpoints can only be taken and resumed from in sim mode, outside a sweep\n";
+    exit(0);
+  }
+
+  /* given a number of replicas, simulating that many independent replicas of the workload instead */
+  if (numReplicas > 0) {
+    if (!simulated || executing || quanta.size()*thresholds.size() > 1 || timelineFileName != NULL || checkpointFileName != NULL || resumeFileName != NULL) {
+      std::cout << "Replicas are only run in sim mode, outside a sweep, without a timeline or checkpoints\n";
+      exit(0);
+    }
+    std::vector <Process> procs;
+    if (workloadSpec == NULL) {
+      Process p;
+      while (source->next(p)) {
+        procs.push_back(p);
       }
-      /* if the burst time (left) for the process is less than the time quantum for RR... */
-      else {
-        /* ...the process "runs on the CPU" for burst duration */
-        usleep(p.burstTime*1000);
-        /* now the process has finished its CPU burst */
-        gettimeofday(&temp_time, NULL);
-        p.finishTime = (temp_time.tv_sec * 1000000 + temp_time.tv_usec +0.0)/1000;
-        fprintf(fp, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", p.id, p.initQueueLevel, p.currQueueLevel, p.finishTime, (p.finishTime - st));
-        fprintf(stdout, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", p.id, p.initQueueLevel, p.currQueueLevel, p.finishTime, (p.finishTime - st));
-        sum_tat += (p.finishTime - st);
-        /* each time a process finishes its CPU burst, the scheduler checks if any processes
-           have been waiting for too long */
-        checkThreshold();
+      if (procs.size() < 2) {
+        std::cout << "Expected at least 2 processes in the input file to resample\n";
+        exit(0);
+      }
+    }
+    runReplicas(numReplicas, (workloadSpec != NULL) ? &gen : NULL, procs, fp);
+    fprintf(fp, "\n\n");
+    fclose(fp);
+    return 0;
+  }
+
+  /* given more than one time quantum or threshold, simulating every combination of them instead */
+  if (quanta.size()*thresholds.size() > 1) {
+    if (executing) {
+      std::cout << "A sweep is only simulated; give a single time quantum and threshold in exec mode\n";
+      exit(0);
+    }
+    if (timelineFileName != NULL) {
+      std::cout << "A timeline can only be recorded in real or sim mode\n";
+      exit(0);
+    }
+    if (quantumTuner.on) {
+      std::cout << "An adaptive quantum can't be swept over; give a single starting quantum with -Q\n";
+      exit(0);
+    }
+    std::vector <Process> procs;
+    Process p;
+    while (source->next(p)) {
+      procs.push_back(p);
+    }
+    runSweep(procs, quanta, thresholds, fp);
+    fprintf(fp, "\n\n");
+    fclose(fp);
+    return 0;
+  }
+
+  /* in exec mode, running the processes on numCpus worker threads instead */
+  if (executing) {
+    if (preemptive) {
+      std::cout << "Preemption is not supported in exec mode\n";
+      exit(0);
+    }
+    /* SRTF always preempts, so in exec mode it would silently be SJF */
+    for (AnyLevel& level : parseLevels(levelSpec, tq)) {
+      if (std::holds_alternative <Level<SRTFPolicy>> (level)) {
+        std::cout << "SRTF levels preempt, which is not supported in exec mode; use sjf instead\n";
+        exit(0);
       }
     }
+    if (timelineFileName != NULL) {
+      std::cout << "A timeline can only be recorded in real or sim mode\n";
+      exit(0);
+    }
+    if (costModel.enabled()) {
+      std::cout << "Switching costs are only modelled in real or sim mode; exec mode pays the real ones\n";
+      exit(0);
+    }
+    if (grouped) {
+      std::cout << "Groups are only scheduled in real or sim mode\n";
+      exit(0);
+    }
+    if (quantumTuner.on) {
+      std::cout << "The quantum is only adaptive in real or sim mode\n";
+      exit(0);
+    }
+    if (topology.on) {
+      std::cout << "Placement by affinity is only modelled in real or sim mode; exec mode leaves it to the OS\n";
+      exit(0);
+    }
+    Executor ex(parseLevels(levelSpec, tq), numCpus, fp, &clog);
+    clog.open(bfp != NULL ? bfp : fp, bfp != NULL);
+    ex.run(source);
+    clog.close();
+    ex.report();
+    fprintf(fp, "\n\n");
+    fclose(fp);
+    if (bfp != NULL) {
+      fclose(bfp);
+    }
+    if (workloadSpec == NULL) {
+      trace.close();
+    }
+    return 0;
+  }
+
+  if (resumeFileName != NULL && timelineFileName != NULL) {
+    std::cout << "A timeline can only be recorded from the start of a run, not when resuming one\n";
+    exit(0);
+  }
 
-    /* while there are no processes left in queue 1, but there are processes in queue 2
-       (Shortest Job First) left to be scheduled */
-    while (q1.empty() && !q2.empty()) {
-      p = q2.top();
-      q2.pop();
-      /* the priority queue implementation ensures that the process with the next shortest
-         burst time is now at the head of the queue; so, this process gets scheduled */
-      usleep(p.burstTime*1000);
-      /* now the process has finished its CPU burst */
-      gettimeofday(&temp_time, NULL);
-      p.finishTime = (temp_time.tv_sec * 1000000 + temp_time.tv_usec +0.0)/1000;
-      fprintf(fp, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", p.id, p.initQueueLevel, p.currQueueLevel, p.finishTime, (p.finishTime - st));
-      fprintf(stdout, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", p.id, p.initQueueLevel, p.currQueueLevel, p.finishTime, (p.finishTime - st));
-      sum_tat += (p.finishTime - st);
-      /* each time a process finishes its CPU burst, the scheduler checks if any processes
-         have been waiting for too long */
-      checkThreshold();
-    }
-
-    /* while there are no processes left in queue 1 and queue 2, but there are processes
-       in queue 3 (Shortest Job First) left to be scheduled */
-    while (q1.empty() && q2.empty() && !q3.empty()) {
-      p = q3.top();
-      q3.pop();
-      /* the priority queue implementation ensures that the process with the next shortest
-         burst time is now at the head of the queue; so, this process gets scheduled */
-      usleep(p.burstTime*1000);
-      /* now the process has finished its CPU burst */
-      gettimeofday(&temp_time, NULL);
-      p.finishTime = (temp_time.tv_sec * 1000000 + temp_time.tv_usec +0.0)/1000;
-      fprintf(fp, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", p.id, p.initQueueLevel, p.currQueueLevel, p.finishTime, (p.finishTime - st));
-      fprintf(stdout, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", p.id, p.initQueueLevel, p.currQueueLevel, p.finishTime, (p.finishTime - st));
-      sum_tat += (p.finishTime - st);
-      /* each time a process finishes its CPU burst, the scheduler checks if any processes
-         have been waiting for too long */
-      checkThreshold();
-    }
-
-    /* while there are no processes left in queues 1, 2 and 3, but there are processes
-       in queue 4 (First Come First Served) left to be scheduled */
-    while (q1.empty() && q2.empty() && q3.empty() && !q4.empty()) {
-      p = q4.front();
-      q4.pop();
-      /* the process that arrived first is at the head of the queue; so, as per the FCFS
-         scheme, this process gets scheduled */
-      usleep(p.burstTime*1000);
-      /* now the process has finished its CPU burst */
-      gettimeofday(&temp_time, NULL);
-      p.finishTime = (temp_time.tv_sec * 1000000 + temp_time.tv_usec +0.0)/1000;
-      fprintf(fp, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", p.id, p.initQueueLevel, p.currQueueLevel, p.finishTime, (p.finishTime - st));
-      fprintf(stdout, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", p.id, p.initQueueLevel, p.currQueueLevel, p.finishTime, (p.finishTime - st));
-      sum_tat += (p.finishTime - st);
-      /* each time a process finishes its CPU burst, the scheduler checks if any processes
-         have been waiting for too long */
-      checkThreshold();
-    }
-
-    /* updating the number of processes still left to be scheduled/run */
-    flag = q1.size() + q2.size() + q3.size() + q4.size();
-  }
-
-  /* taking note of the end time of the program */
-  gettimeofday(&end_time, NULL);
-  et = (end_time.tv_sec * 1000000 + end_time.tv_usec + 0.0)/1000;
+  Scheduler sched(parseLevels(levelSpec, tq), numCpus, threshold, preemptive, simulated, &clog);
+  sched.addDevices(deviceTimes);
+  sched.cost = costModel;
+  sched.tuner = quantumTuner;
+  sched.topo = topology;
+  sched.setGroups(&groupTree, grouped ? tq : 0);
+  sched.setSeed(runSeed);
+
+  /* reading the process information from the input file (or generating it) as the processes arrive,
+     either from the start, or from where the snapshot to resume from left off */
+  if (resumeFileName != NULL) {
+    sched.trace = source;
+    sched.restore(resumeFileName);
+    fprintf(fp, "Resumed from %s at %.2lf (ms), with %ld processes finished\n", resumeFileName, sched.clock.now, sched.completed());
+    fprintf(stdout, "Resumed from %s at %.2lf (ms), with %ld processes finished\n", resumeFileName, sched.clock.now, sched.completed());
+  }
+  else {
+    sched.addProcessesToQueue(source);
+  }
+
+  /* recording the timeline of scheduling decisions, if asked to */
+  TimelineWriter timeline;
+  if (timelineFileName != NULL) {
+    timeline.open(timelineFileName, numCpus, numLevels, deviceTimes.size());
+    sched.timeline = &timeline;
+  }
+
+  /* running the scheduler until all the processes have finished their CPU bursts */
+  double wallStart = wallTime();
+  clog.open(bfp != NULL ? bfp : fp, bfp != NULL);
+  long checkpoints = 0;
+  if (checkpointFileName != NULL) {
+    /* stopping at every multiple of checkpointEvery ms to save a snapshot, but only once for each stretch
+       of time without events */
+    double at = (floor(sched.clock.now/checkpointEvery) + 1)*checkpointEvery;
+    while (1) {
+      while (sched.step(at)) {
+      }
+      if (sched.events.empty()) {
+        break;
+      }
+      sched.save(checkpointFileName);
+      checkpoints++;
+      at = (floor(sched.events.top().time/checkpointEvery) + 1)*checkpointEvery;
+    }
+  }
+  sched.run();
+  double wallTaken = wallTime() - wallStart;
+  clog.close();
+  if (timelineFileName != NULL) {
+    timeline.close();
+  }
 
   /* calculating the mean turnaround time and throughput */
-  fprintf(fp, "Mean Turnaround Time: %-5.2lf (ms); Throughput: %-5.2lf (processes/sec)\n", (sum_tat/num_proc), (num_proc*1000.0)/(et-st));
-  fprintf(stdout, "Mean Turnaround Time: %-5.2lf (ms); Throughput: %-5.2lf (processes/sec)\n", (sum_tat/num_proc), (num_proc*1000.0)/(et-st));
+  int num_proc = sched.numProc;
+  fprintf(fp, "Mean Turnaround Time: %-5.2lf (ms); Throughput: %-5.2lf (processes/sec)\n", (sched.sumTat/num_proc), (num_proc*1000.0)/sched.makespan);
+  fprintf(stdout, "Mean Turnaround Time: %-5.2lf (ms); Throughput: %-5.2lf (processes/sec)\n", (sched.sumTat/num_proc), (num_proc*1000.0)/sched.makespan);
+
+  /* reporting the tail of the waiting, response and turnaround times */
+  sched.latency.report(fp);
+  sched.latency.report(stdout);
+
+  /* with more than one CPU, also reporting how evenly the work was spread across them */
+  if (numCpus > 1) {
+    double maxBusy = 0, sumBusy = 0;
+    int c;
+    for (c = 0; c < numCpus; c++) {
+      Core& core = sched.cores[c];
+      fprintf(fp, "CPU: %-4d; Utilisation: %6.2lf%%; Dispatches: %-7ld; Stolen: %ld\n", c, (100.0*core.busyTime)/sched.makespan, core.dispatches, core.stolen);
+      fprintf(stdout, "CPU: %-4d; Utilisation: %6.2lf%%; Dispatches: %-7ld; Stolen: %ld\n", c, (100.0*core.busyTime)/sched.makespan, core.dispatches, core.stolen);
+      sumBusy += core.busyTime;
+      if (core.busyTime > maxBusy) {
+        maxBusy = core.busyTime;
+      }
+    }
+    /* the load imbalance is how far the busiest CPU is above the average, as a fraction of the average */
+    double imbalance = (sumBusy > 0) ? (maxBusy*numCpus)/sumBusy - 1 : 0;
+    fprintf(fp, "Migrations: %ld; Load Imbalance: %-5.3lf\n", sched.migrations, imbalance);
+    fprintf(stdout, "Migrations: %ld; Load Imbalance: %-5.3lf\n", sched.migrations, imbalance);
+  }
+
+  /* with affinity, reporting how often processes moved between CPUs (and nodes), what the moves cost, and
+     the TATs of the processes that moved against those of the ones that stayed put */
+  if (topology.on) {
+    AffinityStats& a = sched.affinity;
+    long dispatches = 0;
+    int c;
+    for (c = 0; c < numCpus; c++) {
+      dispatches += sched.cores[c].dispatches;
+    }
+    double rate = (dispatches > 0) ? (100.0*a.moves)/dispatches : 0;
+    double movedTat = (a.finished[1] > 0) ? a.sumTat[1]/a.finished[1] : 0;
+    double stayedTat = (a.finished[0] > 0) ? a.sumTat[0]/a.finished[0] : 0;
+    fprintf(fp, "Affinity: %-6s; Nodes: %d; Moves: %ld (%ld across nodes); Move Rate: %.2lf%% of dispatches; Move Time: %.2lf (ms)\n", topology.policyName(), topology.nodes, a.moves, a.remoteMoves, rate, a.moveTime);
+    fprintf(stdout, "Affinity: %-6s; Nodes: %d; Moves: %ld (%ld across nodes); Move Rate: %.2lf%% of dispatches; Move Time: %.2lf (ms)\n", topology.policyName(), topology.nodes, a.moves, a.remoteMoves, rate, a.moveTime);
+    fprintf(fp, "Mean TAT(ms): moved: %-8.2lf (%ld processes); never moved: %-8.2lf (%ld processes)\n", movedTat, a.finished[1], stayedTat, a.finished[0]);
+    fprintf(stdout, "Mean TAT(ms): moved: %-8.2lf (%ld processes); never moved: %-8.2lf (%ld processes)\n", movedTat, a.finished[1], stayedTat, a.finished[0]);
+  }
+
+  /* with I/O devices, reporting how busy the CPUs and each device were, and how long requests queued */
+  if (!deviceTimes.empty()) {
+    double sumBusy = 0;
+    int c;
+    for (c = 0; c < numCpus; c++) {
+      sumBusy += sched.cores[c].busyTime;
+    }
+    fprintf(fp, "CPU Utilisation: %6.2lf%%\n", (100.0*sumBusy)/(numCpus*sched.makespan));
+    fprintf(stdout, "CPU Utilisation: %6.2lf%%\n", (100.0*sumBusy)/(numCpus*sched.makespan));
+    size_t d;
+    for (d = 0; d < sched.devices.size(); d++) {
+      Device& dev = sched.devices[d];
+      double delay = (dev.requests > 0) ? dev.sumQueueDelay/dev.requests : 0;
+      fprintf(fp, "Device: %-3d; Utilisation: %6.2lf%%; Requests: %-7ld; Mean Queueing Delay(ms): %.2lf\n", (int) d + 1, (100.0*dev.busyTime)/sched.makespan, dev.requests, delay);
+      fprintf(stdout, "Device: %-3d; Utilisation: %6.2lf%%; Requests: %-7ld; Mean Queueing Delay(ms): %.2lf\n", (int) d + 1, (100.0*dev.busyTime)/sched.makespan, dev.requests, delay);
+    }
+  }
+
+  /* with an adaptive quantum, reporting where it ended up and every change made to it (in the logs file) */
+  if (quantumTuner.on) {
+    const std::vector<QuantumChange>& changes = sched.tuner.changes;
+    int initial = changes.empty() ? sched.firstQuantum() : changes[0].from;
+    int low = initial, high = initial;
+    size_t k;
+    for (k = 0; k < changes.size(); k++) {
+      low = (changes[k].to < low) ? changes[k].to : low;
+      high = (changes[k].to > high) ? changes[k].to : high;
+      fprintf(fp, "Quantum Change: at %.2lf (ms); %d -> %d (ms); p%g of recent bursts: %.2lf (ms)\n", changes[k].time, changes[k].from, changes[k].to, quantumTuner.pct, changes[k].percentile);
+    }
+    fprintf(fp, "Adaptive Quantum: initial %d (ms); final %d (ms); range %d - %d (ms); changes: %ld; bursts seen: %ld\n", initial, sched.firstQuantum(), low, high, (long) changes.size(), sched.tuner.seen);
+    fprintf(stdout, "Adaptive Quantum: initial %d (ms); final %d (ms); range %d - %d (ms); changes: %ld; bursts seen: %ld\n", initial, sched.firstQuantum(), low, high, (long) changes.size(), sched.tuner.seen);
+  }
+
+  /* with groups, reporting the throughput, share of the CPU time and latencies of each group's processes;
+     the share is of the CPU time given out while groups competed for it, as that is when it follows their
+     shares (a group alone on a CPU gets all of it) */
+  if (grouped) {
+    double cpuTime = 0;
+    int g;
+    for (g = 0; g < groupTree.size(); g++) {
+      cpuTime += sched.groupStats[g].contendedTime;
+    }
+    for (g = 0; g < groupTree.size(); g++) {
+      GroupStats& gs = sched.groupStats[g];
+      if (!groupTree.leaf(g) || gs.completions == 0) {
+        continue;
+      }
+      fprintf(fp, "Group: %-12s; Shares: %-5.1lf; Completed: %-7ld; Throughput: %-7.2lf (processes/sec); Contended CPU Share: %6.2lf%%; Mean Response(ms): %-8.2lf; p99 Response(ms): %-8.2lf; Mean TAT(ms): %-8.2lf; p99 TAT(ms): %-8.2lf\n", groupTree.name[g].c_str(), groupTree.shares[g], gs.completions, (gs.completions*1000.0)/sched.makespan, (cpuTime > 0) ? (100.0*gs.contendedTime)/cpuTime : 0, gs.response.sum/gs.completions, gs.response.percentile(0.99), gs.sumTat/gs.completions, gs.tat.percentile(0.99));
+      fprintf(stdout, "Group: %-12s; Shares: %-5.1lf; Completed: %-7ld; Throughput: %-7.2lf (processes/sec); Contended CPU Share: %6.2lf%%; Mean Response(ms): %-8.2lf; p99 Response(ms): %-8.2lf; Mean TAT(ms): %-8.2lf; p99 TAT(ms): %-8.2lf\n", groupTree.name[g].c_str(), groupTree.shares[g], gs.completions, (gs.completions*1000.0)/sched.makespan, (cpuTime > 0) ? (100.0*gs.contendedTime)/cpuTime : 0, gs.response.sum/gs.completions, gs.response.percentile(0.99), gs.sumTat/gs.completions, gs.tat.percentile(0.99));
+    }
+  }
+
+  /* with a cost model, reporting how much of the CPUs' time went on switching between processes */
+  if (costModel.enabled()) {
+    long switches = 0;
+    double switchTime = 0, refillTime = 0, busyTime = 0;
+    int c;
+    for (c = 0; c < numCpus; c++) {
+      switches += sched.cores[c].switches;
+      switchTime += sched.cores[c].switchTime;
+      refillTime += sched.cores[c].refillTime;
+      busyTime += sched.cores[c].busyTime;
+    }
+    double overhead = (busyTime > 0) ? (100.0*(switchTime + refillTime))/busyTime : 0;
+    fprintf(fp, "Context switches: %ld; Switch Time: %.2lf (ms); Cache Refill Time: %.2lf (ms); Overhead: %.2lf%% of CPU time\n", switches, switchTime, refillTime, overhead);
+    fprintf(stdout, "Context switches: %ld; Switch Time: %.2lf (ms); Cache Refill Time: %.2lf (ms); Overhead: %.2lf%% of CPU time\n", switches, switchTime, refillTime, overhead);
+  }
+
+  if (checkpointFileName != NULL) {
+    fprintf(fp, "Checkpoints: %ld, every %.2lf (ms), into %s\n", checkpoints, checkpointEvery, checkpointFileName);
+    fprintf(stdout, "Checkpoints: %ld, every %.2lf (ms), into %s\n", checkpoints, checkpointEvery, checkpointFileName);
+  }
+
+  /* in simulated mode, also reporting how fast the simulation itself ran */
+  if (simulated) {
+    fprintf(stdout, "Aging promotions: %ld; Log stalls: %ld\n", sched.promotions, clog.stalls.load());
+    fprintf(stdout, "Scheduling decisions: %ld; Wall time: %-5.2lf (ms); Decisions/sec: %-5.0lf\n", sched.decisions, wallTaken, (sched.decisions*1000.0)/(wallTaken > 0 ? wallTaken : 1e-3));
+  }
+
+  /* when processes can be preempted (in preemptive mode, or by an SRTF level, which always preempts),
+     reporting how often they were, and, in preemptive simulated mode, how much the response and
+     turnaround times gained over simulating the same processes without preemption */
+  int preempting = preemptive;
+  for (AnyLevel& level : parseLevels(levelSpec, tq)) {
+    if (std::holds_alternative <Level<SRTFPolicy>> (level)) {
+      preempting = 1;
+    }
+  }
+  if (preempting) {
+    fprintf(fp, "Preemptions: %ld\n", sched.preemptions);
+    fprintf(stdout, "Preemptions: %ld\n", sched.preemptions);
+    if (preemptive && simulated) {
+      TraceReader baseTrace;
+      WorkloadGenerator baseGen;
+      ProcessSource* baseSource;
+      if (workloadSpec != NULL) {
+        baseGen.init(workloadSpec, numLevels, deviceTimes.size(), &groupTree);
+        baseSource = &baseGen;
+      }
+      else {
+        baseTrace.open(inputFileName, numLevels, deviceTimes.size(), &groupTree);
+        baseSource = &baseTrace;
+      }
+      Scheduler base(parseLevels(levelSpec, tq), numCpus, threshold, 0, 1, NULL);
+      base.addDevices(deviceTimes);
+      base.cost = costModel;
+      base.topo = topology;
+      base.tuner = quantumTuner;
+      base.setGroups(&groupTree, grouped ? tq : 0);
+      base.setSeed(runSeed);
+      base.addProcessesToQueue(baseSource);
+      base.run();
+      if (workloadSpec == NULL) {
+        baseTrace.close();
+      }
+      int g;
+      for (g = 0; g <= numLevels; g++) {
+        Histogram& resp = sched.latency.of(LAT_RESPONSE, g);
+        Histogram& baseResp = base.latency.of(LAT_RESPONSE, g);
+        Histogram& tat = sched.latency.of(LAT_TAT, g);
+        Histogram& baseTat = base.latency.of(LAT_TAT, g);
+        if (resp.total == 0) {
+          continue;
+        }
+        char group[24];
+        if (g == 0) {
+          strcpy(group, "all");
+        }
+        else {
+          snprintf(group, sizeof(group), "level %d", g);
+        }
+        /* each pair is without -> with preemption */
+        fprintf(fp, "Preemption Gain(ms): %-8s; Mean Response: %.2lf -> %.2lf; p99 Response: %.2lf -> %.2lf; Mean Turnaround: %.2lf -> %.2lf\n", group, baseResp.sum/baseResp.total, resp.sum/resp.total, baseResp.percentile(0.99), resp.percentile(0.99), baseTat.sum/baseTat.total, tat.sum/tat.total);
+        fprintf(stdout, "Preemption Gain(ms): %-8s; Mean Response: %.2lf -> %.2lf; p99 Response: %.2lf -> %.2lf; Mean Turnaround: %.2lf -> %.2lf\n", group, baseResp.sum/baseResp.total, resp.sum/resp.total, baseResp.percentile(0.99), resp.percentile(0.99), baseTat.sum/baseTat.total, tat.sum/tat.total);
+      }
+    }
+  }
 
   fprintf(fp, "\n\n");
   fclose(fp);
+  if (bfp != NULL) {
+    fclose(bfp);
+  }
+  if (workloadSpec == NULL) {
+    trace.close();
+  }
 
   return 0;
 }
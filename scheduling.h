@@ -0,0 +1,4232 @@
+/* the multi-level feedback queue scheduler, as a library: the Scheduler class (and the Executor, which runs
+   processes for real on worker threads) along with the queues, workload sources, statistics and logs they
+   use, so that schedulers can be embedded in other programs, several to a process; scheduling.cpp is the
+   command-line driver around it */
+#ifndef SCHEDULING_H
+#define SCHEDULING_H
+
+#include <cstdio>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <queue>
+#include <deque>
+#include <vector>
+#include <variant>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sched.h>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <cmath>
+#include <algorithm>
+
+#define EV_BURST_END 0     /* the process on the CPU has finished its time slice / CPU burst */
+#define EV_ARRIVAL   1     /* a process arrives into the queue it was assigned to */
+#define EV_IO_END    2     /* the device has finished serving the I/O request of the process at its head */
+#define EV_AGING     3     /* a process waiting on the CPU is due to be upgraded (only in preemptive mode) */
+
+#define MAX_DEVICES 64     /* the maximum number of simulated I/O devices */
+#define MAX_GROUPS 256     /* the maximum number of groups processes can be scheduled on behalf of */
+#define ROOT_GROUP 0       /* the group at the top of the hierarchy */
+#define DEFAULT_GROUP 1    /* the group of the processes that don't give one */
+
+#define TRACE_CHUNK_SIZE (1 << 20)   /* the size (bytes) of the chunks in which the input file is read */
+
+#define MAX_LEVELS 16      /* the maximum number of queue levels the scheduler can be configured with */
+#define MAX_CPUS 1024      /* the maximum number of CPUs that can be simulated */
+
+#define DEFAULT_TICKETS 100        /* the tickets of a process that doesn't give its own, in lottery and stride levels */
+#define STRIDE1 1048576.0          /* the pass a process with one ticket gains per ms it runs, in a stride level */
+
+#define PLACE_STRICT 0     /* a process only ever runs on the CPU it first ran on */
+#define PLACE_SOFT   1     /* a process goes back to the CPU it last ran on, unless that CPU is much busier */
+#define PLACE_LOCAL  2     /* as soft, but falling back to (and stealing from) CPUs on the same node first */
+
+#define LOG_RING_SIZE (1 << 16)  /* the number of completion records the log can hold before they are written */
+#define LOG_BATCH 1024           /* the maximum number of completion records written at a time */
+#define LOG_IDLE_US 200          /* how long (us) the log writer sleeps when there is nothing to write */
+#define LOG_MAGIC "MLFQLOG1"     /* the header of a binary log */
+
+#define TIMELINE_BUFFER_SIZE (1 << 22)  /* the size of the stdio buffer the timeline is written through */
+#define TL_PID_CPUS 1            /* the timeline "process" holding the track of each CPU */
+#define TL_PID_LEVELS 2          /* the timeline "process" holding the track of each queue level */
+#define TL_PID_DEVICES 3         /* the timeline "process" holding the track of each I/O device */
+
+#define EXEC_MAX_INFLIGHT 4096   /* the maximum number of processes the executor has arrived and not finished */
+#define HIST_SUB_BITS 7                     /* the number of bits of precision kept by the latency histograms */
+#define HIST_MAX_VALUE ((1ull << 40) - 1)   /* the largest latency (us) the histograms tell apart */
+
+#define EXEC_BUCKETS 16          /* the number of FIFO queues that make up an ordered level in the executor */
+
+#define NIL_HANDLE 0xffffffffu   /* the handle that refers to no process */
+
+#define SNAPSHOT_MAGIC "MLFQSNP3"   /* the header of a snapshot of a scheduler */
+
+/* a snapshot of the state of a scheduler in a binary file; the same code both writes and reads one, by
+   passing each piece of state to it in the same order either way, to be written out when saving or read
+   back into place when loading */
+class Snapshot {
+  public:
+    FILE* fp;       /* the snapshot file */
+    int loading;    /* whether the snapshot is being read back (1) or written (0) */
+
+    /* a plain value, copied as it is */
+    template <class T>
+    void raw(T& v) {
+      static_assert(std::is_trivially_copyable <T>::value, "only plain values are copied as they are");
+      if (!loading) {
+        fwrite(&v, sizeof(T), 1, fp);
+      }
+      else if (fread(&v, sizeof(T), 1, fp) != 1) {
+        truncated();
+      }
+    }
+
+    /* a vector of plain values, preceded by its size */
+    template <class T>
+    void vec(std::vector<T>& v) {
+      static_assert(std::is_trivially_copyable <T>::value, "only plain values are copied as they are");
+      uint64_t n = v.size();
+      raw(n);
+      if (loading) {
+        v.resize(n);
+      }
+      /* an empty vector may have no storage to point to */
+      if (n == 0) {
+        return;
+      }
+      if (!loading) {
+        fwrite(v.data(), sizeof(T), n, fp);
+        return;
+      }
+      if (fread(v.data(), sizeof(T), n, fp) != n) {
+        truncated();
+      }
+    }
+
+    /* a vector of objects that take part in snapshots themselves, preceded by its size */
+    template <class T>
+    void list(std::vector<T>& v) {
+      uint64_t n = v.size();
+      raw(n);
+      if (loading) {
+        v.resize(n);
+      }
+      size_t i;
+      for (i = 0; i < v.size(); i++) {
+        v[i].snapshot(*this);
+      }
+    }
+
+    /* a setting that the scheduler being loaded into must share with the one that was saved */
+    void check(long v, const char* what) {
+      long saved = v;
+      raw(saved);
+      if (saved != v) {
+        std::cout << "Expected the snapshot to be of a scheduler with the same " << what << ", but it has " << saved << ", not " << v << "\n";
+        exit(0);
+      }
+    }
+
+    void truncated() {
+      std::cout << "Expected a complete snapshot, but it ends early\n";
+      exit(0);
+    }
+};
+
+/* a small, fast pseudo-random number generator (xoshiro256**, seeded through splitmix64), so that a seed
+   gives the same workload on every platform */
+class Rng {
+  public:
+    uint64_t s[4];
+
+    void seed(uint64_t x) {
+      int i;
+      for (i = 0; i < 4; i++) {
+        x += 0x9e3779b97f4a7c15ull;
+        uint64_t z = x;
+        z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+        s[i] = z ^ (z >> 31);
+      }
+    }
+
+    uint64_t next() {
+      uint64_t result = rotl(s[1]*5, 7)*9;
+      uint64_t t = s[1] << 17;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl(s[3], 45);
+      return result;
+    }
+
+    static uint64_t rotl(uint64_t x, int k) {
+      return (x << k) | (x >> (64 - k));
+    }
+
+    /* a value drawn uniformly from (0, 1) */
+    double uniform() {
+      return ((next() >> 11) + 0.5)*(1.0/9007199254740992.0);
+    }
+
+    /* a value drawn from the exponential distribution with the given mean */
+    double exponential(double mean) {
+      return -mean*log(uniform());
+    }
+};
+
+/* an I/O request that a process makes after a CPU burst, followed by its next CPU burst */
+class BurstPhase {
+  public:
+    int device;                 /* the device (from 1) that serves the request */
+    int ioTime;                 /* the time the device takes to serve it (-1 for the device's service time) */
+    int cpuTime;                /* the duration of the CPU burst after it (0 if the process then ends) */
+};
+
+/* a process as it is read from the input file */
+class Process {
+  public:
+    int id;                     /* the process ID */
+    int initQueueLevel;         /* the level of the first queue the process was assigned to */
+    int currQueueLevel;         /* the level of the queue the process is currently in */
+    int burstTime;              /* the duration of the (first) CPU burst for the process */
+    double arrivalTime;         /* the time at which the process first joined a queue */
+    double currArrivalTime;     /* the time at which the process joined the current queue */
+    double finishTime;          /* the time at which the process finished its CPU burst execution */
+    std::vector <BurstPhase> phases;   /* the I/O requests and CPU bursts after the first burst, if any */
+    int workingSet;             /* the size (KB) of the process's working set (0 for the default) */
+    double deadline;            /* the time by which the process should finish (INFINITY if it has no deadline) */
+    double weight;              /* the process's share of the CPU relative to others in a fair-share level (default 1) */
+    uint32_t tickets;           /* the process's tickets, in lottery and stride levels (default DEFAULT_TICKETS) */
+    int group;                  /* the group the process is scheduled on behalf of */
+
+    /* a process with none of the optional settings, so that one made by hand needs just its ID, level and
+       burst (and arrival time) */
+    Process() {
+      id = 0;
+      initQueueLevel = 1;
+      currQueueLevel = 1;
+      burstTime = 0;
+      arrivalTime = 0;
+      currArrivalTime = 0;
+      finishTime = 0;
+      workingSet = 0;
+      deadline = INFINITY;
+      weight = 1;
+      tickets = DEFAULT_TICKETS;
+      group = DEFAULT_GROUP;
+    }
+
+    void snapshot(Snapshot& s) {
+      s.raw(id);
+      s.raw(initQueueLevel);
+      s.raw(currQueueLevel);
+      s.raw(burstTime);
+      s.raw(arrivalTime);
+      s.raw(currArrivalTime);
+      s.raw(finishTime);
+      s.vec(phases);
+      s.raw(workingSet);
+      s.raw(deadline);
+      s.raw(weight);
+      s.raw(tickets);
+      s.raw(group);
+    }
+};
+
+/* a reference to a process in the process table */
+typedef uint32_t Handle;
+
+/* the processes in the system, stored as one array per field, indexed by the handle the process is given
+   on arrival; the queues only hold handles, so ordering and moving processes touches just the fields
+   involved, and a handle is reused once its process has finished */
+class ProcessTable {
+  public:
+    std::vector <int> id;                   /* the process ID */
+    std::vector <uint8_t> initQueueLevel;   /* the level of the first queue the process was assigned to */
+    std::vector <uint8_t> currQueueLevel;   /* the level of the queue the process is currently in */
+    std::vector <double> burstTime;         /* the duration of the CPU burst left for the process */
+    std::vector <double> burstLength;       /* the full duration of the process's current CPU burst */
+    std::vector <double> arrivalTime;       /* the time at which the process first joined a queue */
+    std::vector <double> currArrivalTime;   /* the time at which the process joined the current queue */
+    std::vector <int> serviceTime;          /* the duration of all the CPU bursts of the process */
+    std::vector <std::vector<BurstPhase>> phases;   /* the I/O requests and CPU bursts after the first burst */
+    std::vector <uint32_t> phase;           /* the index of the next of those phases */
+    std::vector <double> blockedTime;       /* the time the process spent waiting for or doing I/O */
+    std::vector <int> workingSet;           /* the size (KB) of the process's working set (0 for the default) */
+    std::vector <double> deadline;          /* the time by which the process should finish (INFINITY if none) */
+    std::vector <double> weight;            /* the process's relative share of the CPU in a fair-share level */
+    std::vector <double> vruntime;          /* the CPU time the process has had, divided by its weight */
+    std::vector <uint32_t> tickets;         /* the process's tickets, in lottery and stride levels */
+    std::vector <double> pass;              /* the process's pass, in a stride level: its stride for each quantum it was picked for */
+    std::vector <uint16_t> group;           /* the group the process is scheduled on behalf of */
+    std::vector <double> firstRunTime;      /* the time at which the process was first picked to run (-1 if not yet) */
+    std::vector <uint8_t> aged;             /* whether the process has been upgraded by aging */
+    std::vector <int16_t> lastCpu;          /* the CPU the process last ran on (-1 if none yet) */
+    std::vector <uint8_t> migrated;         /* whether the process has run on more than one CPU */
+    std::vector <Handle> next;              /* the next process in the same (FIFO) queue, or next sibling in its pairing heap */
+    std::vector <Handle> prev;              /* the previous process in the same (FIFO) queue, or previous sibling (or parent) */
+    std::vector <Handle> child;             /* the first child of the process in its queue's pairing heap */
+    std::vector <uint32_t> heapPos;         /* the position of the process in its queue's heap */
+    std::vector <uint32_t> agingPos;        /* the position of the process in the aging index */
+    std::vector <Handle> freeHandles;       /* the handles of processes that have finished */
+
+    /* to add an arriving process to the table, returning its handle */
+    Handle add(const Process& p) {
+      Handle h;
+      if (!freeHandles.empty()) {
+        h = freeHandles.back();
+        freeHandles.pop_back();
+      }
+      else {
+        h = id.size();
+        id.push_back(0);
+        initQueueLevel.push_back(0);
+        currQueueLevel.push_back(0);
+        burstTime.push_back(0);
+        burstLength.push_back(0);
+        arrivalTime.push_back(0);
+        currArrivalTime.push_back(0);
+        serviceTime.push_back(0);
+        phases.push_back(std::vector<BurstPhase>());
+        phase.push_back(0);
+        blockedTime.push_back(0);
+        workingSet.push_back(0);
+        deadline.push_back(INFINITY);
+        weight.push_back(1);
+        vruntime.push_back(0);
+        tickets.push_back(DEFAULT_TICKETS);
+        pass.push_back(0);
+        group.push_back(DEFAULT_GROUP);
+        firstRunTime.push_back(0);
+        aged.push_back(0);
+        lastCpu.push_back(-1);
+        migrated.push_back(0);
+        next.push_back(NIL_HANDLE);
+        prev.push_back(NIL_HANDLE);
+        child.push_back(NIL_HANDLE);
+        heapPos.push_back(NIL_HANDLE);
+        agingPos.push_back(NIL_HANDLE);
+      }
+      id[h] = p.id;
+      initQueueLevel[h] = p.initQueueLevel;
+      currQueueLevel[h] = p.currQueueLevel;
+      burstTime[h] = p.burstTime;
+      burstLength[h] = p.burstTime;
+      arrivalTime[h] = p.arrivalTime;
+      currArrivalTime[h] = p.currArrivalTime;
+      serviceTime[h] = p.burstTime;
+      phases[h] = p.phases;
+      phase[h] = 0;
+      blockedTime[h] = 0;
+      workingSet[h] = p.workingSet;
+      deadline[h] = p.deadline;
+      weight[h] = p.weight;
+      vruntime[h] = 0;
+      tickets[h] = p.tickets;
+      pass[h] = 0;
+      group[h] = p.group;
+      size_t i;
+      for (i = 0; i < p.phases.size(); i++) {
+        serviceTime[h] += p.phases[i].cpuTime;
+      }
+      firstRunTime[h] = -1;
+      aged[h] = 0;
+      lastCpu[h] = -1;
+      migrated[h] = 0;
+      return h;
+    }
+
+    /* to free the handle of a process that has finished */
+    void release(Handle h) {
+      freeHandles.push_back(h);
+    }
+
+    void snapshot(Snapshot& s) {
+      s.vec(id);
+      s.vec(initQueueLevel);
+      s.vec(currQueueLevel);
+      s.vec(burstTime);
+      s.vec(burstLength);
+      s.vec(arrivalTime);
+      s.vec(currArrivalTime);
+      s.vec(serviceTime);
+      uint64_t n = phases.size();
+      s.raw(n);
+      phases.resize(n);
+      size_t i;
+      for (i = 0; i < n; i++) {
+        s.vec(phases[i]);
+      }
+      s.vec(phase);
+      s.vec(blockedTime);
+      s.vec(workingSet);
+      s.vec(deadline);
+      s.vec(weight);
+      s.vec(vruntime);
+      s.vec(tickets);
+      s.vec(pass);
+      s.vec(group);
+      s.vec(firstRunTime);
+      s.vec(aged);
+      s.vec(lastCpu);
+      s.vec(migrated);
+      s.vec(next);
+      s.vec(prev);
+      s.vec(child);
+      s.vec(heapPos);
+      s.vec(agingPos);
+      s.vec(freeHandles);
+    }
+};
+
+/* a FIFO queue of processes, linked through the next/prev fields of the process table, so that any
+   process can be unlinked from it in O(1) */
+class HandleList {
+  public:
+    Handle first;     /* the process at the head of the queue */
+    Handle last;      /* the process at the tail of the queue */
+    long count;       /* the number of processes in the queue */
+
+    HandleList() {
+      first = NIL_HANDLE;
+      last = NIL_HANDLE;
+      count = 0;
+    }
+
+    int empty() const { return count == 0; }
+    long size() const { return count; }
+    Handle top() const { return first; }
+
+    void push(ProcessTable& t, Handle h) {
+      t.next[h] = NIL_HANDLE;
+      t.prev[h] = last;
+      if (last == NIL_HANDLE) {
+        first = h;
+      }
+      else {
+        t.next[last] = h;
+      }
+      last = h;
+      count++;
+    }
+
+    /* to put the process h back at the head of the queue */
+    void pushFront(ProcessTable& t, Handle h) {
+      t.prev[h] = NIL_HANDLE;
+      t.next[h] = first;
+      if (first == NIL_HANDLE) {
+        last = h;
+      }
+      else {
+        t.prev[first] = h;
+      }
+      first = h;
+      count++;
+    }
+
+    void remove(ProcessTable& t, Handle h) {
+      if (t.prev[h] == NIL_HANDLE) {
+        first = t.next[h];
+      }
+      else {
+        t.next[t.prev[h]] = t.next[h];
+      }
+      if (t.next[h] == NIL_HANDLE) {
+        last = t.prev[h];
+      }
+      else {
+        t.prev[t.next[h]] = t.prev[h];
+      }
+      count--;
+    }
+
+    Handle pop(ProcessTable& t) {
+      Handle h = first;
+      remove(t, h);
+      return h;
+    }
+
+    /* the links between the processes are in the process table, so only the ends of the queue are kept */
+    void snapshot(Snapshot& s) {
+      s.raw(first);
+      s.raw(last);
+      s.raw(count);
+    }
+};
+
+/* a binary min heap of processes ordered by Less, which records the position of each process in the
+   table field Pos so that any process can be removed from it, or moved after its key changes, in
+   O(log n) */
+template <class Less, std::vector<uint32_t> ProcessTable::*Pos>
+class HandleHeap {
+  public:
+    std::vector <Handle> h;   /* the heap */
+
+    int empty() const { return h.empty(); }
+    long size() const { return h.size(); }
+    Handle top() const { return h[0]; }
+
+    /* to put the process x at position i, and record it */
+    void place(ProcessTable& t, uint32_t i, Handle x) {
+      h[i] = x;
+      (t.*Pos)[x] = i;
+    }
+
+    /* to move the process at position i towards the root until its parent is not larger */
+    void siftUp(ProcessTable& t, uint32_t i) {
+      Handle x = h[i];
+      while (i > 0) {
+        uint32_t parent = (i - 1)/2;
+        if (!Less()(t, x, h[parent])) {
+          break;
+        }
+        place(t, i, h[parent]);
+        i = parent;
+      }
+      place(t, i, x);
+    }
+
+    /* to move the process at position i towards the leaves until neither child is smaller */
+    void siftDown(ProcessTable& t, uint32_t i) {
+      Handle x = h[i];
+      uint32_t n = h.size();
+      while (2*i + 1 < n) {
+        uint32_t c = 2*i + 1;
+        if (c + 1 < n && Less()(t, h[c+1], h[c])) {
+          c++;
+        }
+        if (!Less()(t, h[c], x)) {
+          break;
+        }
+        place(t, i, h[c]);
+        i = c;
+      }
+      place(t, i, x);
+    }
+
+    void push(ProcessTable& t, Handle x) {
+      h.push_back(x);
+      siftUp(t, h.size() - 1);
+    }
+
+    void remove(ProcessTable& t, Handle x) {
+      uint32_t i = (t.*Pos)[x];
+      Handle y = h.back();
+      h.pop_back();
+      (t.*Pos)[x] = NIL_HANDLE;
+      if (y != x) {
+        place(t, i, y);
+        update(t, y);
+      }
+    }
+
+    Handle pop(ProcessTable& t) {
+      Handle x = h[0];
+      remove(t, x);
+      return x;
+    }
+
+    /* to restore the heap order after the key of process x has changed */
+    void update(ProcessTable& t, Handle x) {
+      uint32_t i = (t.*Pos)[x];
+      siftUp(t, i);
+      siftDown(t, (t.*Pos)[x]);
+    }
+
+    void snapshot(Snapshot& s) {
+      s.vec(h);
+    }
+};
+
+/* a pairing heap of processes ordered by Less, linked through the child/next/prev fields of the process
+   table (prev being the previous sibling, or the parent of a first child), so that a process can be
+   added in O(1), and any process can be removed from it in O(log n) amortized, without the heap ever
+   being rebuilt; the keys of a waiting process never change, so there is no decrease-key */
+template <class Less>
+class HandlePairingHeap {
+  public:
+    Handle root;                  /* the smallest process in the heap */
+    long count;                   /* the number of processes in the heap */
+    std::vector <Handle> pairs;   /* scratch space for the trees being paired up after a removal */
+
+    HandlePairingHeap() {
+      root = NIL_HANDLE;
+      count = 0;
+    }
+
+    int empty() const { return count == 0; }
+    long size() const { return count; }
+    Handle top() const { return root; }
+
+    /* to join the trees rooted at a and b, returning the root of the result */
+    Handle meld(ProcessTable& t, Handle a, Handle b) {
+      if (a == NIL_HANDLE) {
+        return b;
+      }
+      if (b == NIL_HANDLE) {
+        return a;
+      }
+      if (Less()(t, b, a)) {
+        Handle x = a;
+        a = b;
+        b = x;
+      }
+      t.prev[b] = a;
+      t.next[b] = t.child[a];
+      if (t.child[a] != NIL_HANDLE) {
+        t.prev[t.child[a]] = b;
+      }
+      t.child[a] = b;
+      return a;
+    }
+
+    /* to unlink the process x (not the root), along with its subtree, from its parent and siblings */
+    void cut(ProcessTable& t, Handle x) {
+      Handle p = t.prev[x];
+      if (t.child[p] == x) {
+        t.child[p] = t.next[x];
+      }
+      else {
+        t.next[p] = t.next[x];
+      }
+      if (t.next[x] != NIL_HANDLE) {
+        t.prev[t.next[x]] = p;
+      }
+      t.next[x] = NIL_HANDLE;
+      t.prev[x] = NIL_HANDLE;
+    }
+
+    /* to join the list of sibling trees starting at first into one tree, pairing them up from left to right
+       and then melding the pairs from right to left, returning its root */
+    Handle mergePairs(ProcessTable& t, Handle first) {
+      Handle a = first;
+      while (a != NIL_HANDLE) {
+        Handle b = t.next[a];
+        t.next[a] = NIL_HANDLE;
+        t.prev[a] = NIL_HANDLE;
+        if (b == NIL_HANDLE) {
+          pairs.push_back(a);
+          break;
+        }
+        Handle rest = t.next[b];
+        t.next[b] = NIL_HANDLE;
+        t.prev[b] = NIL_HANDLE;
+        pairs.push_back(meld(t, a, b));
+        a = rest;
+      }
+      Handle r = NIL_HANDLE;
+      while (!pairs.empty()) {
+        r = meld(t, pairs.back(), r);
+        pairs.pop_back();
+      }
+      return r;
+    }
+
+    void push(ProcessTable& t, Handle x) {
+      t.child[x] = NIL_HANDLE;
+      t.next[x] = NIL_HANDLE;
+      t.prev[x] = NIL_HANDLE;
+      root = meld(t, root, x);
+      count++;
+    }
+
+    void remove(ProcessTable& t, Handle x) {
+      if (x == root) {
+        root = mergePairs(t, t.child[x]);
+      }
+      else {
+        cut(t, x);
+        root = meld(t, root, mergePairs(t, t.child[x]));
+      }
+      t.child[x] = NIL_HANDLE;
+      count--;
+    }
+
+    Handle pop(ProcessTable& t) {
+      Handle x = root;
+      remove(t, x);
+      return x;
+    }
+
+    /* the shape of the heap is in the process table, so only its root is kept */
+    void snapshot(Snapshot& s) {
+      s.raw(root);
+      s.raw(count);
+    }
+};
+
+/* ordering for the SJF (and SRTF) queues: the process with the shortest burst time (left) first, and
+   among those, the one that joined the queue first */
+class BurstLess {
+  public:
+    bool operator() (const ProcessTable& t, Handle a, Handle b) const {
+      if (t.burstTime[a] != t.burstTime[b]) {
+        return t.burstTime[a] < t.burstTime[b];
+      }
+      if (t.currArrivalTime[a] != t.currArrivalTime[b]) {
+        return t.currArrivalTime[a] < t.currArrivalTime[b];
+      }
+      return a < b;
+    }
+};
+
+/* ordering for the static-priority queues; a process is ranked by the level it was first assigned to, so
+   that processes upgraded from lower queues still yield to those that started here, and then by its
+   arrival */
+class PriorityLess {
+  public:
+    bool operator() (const ProcessTable& t, Handle a, Handle b) const {
+      if (t.initQueueLevel[a] != t.initQueueLevel[b]) {
+        return t.initQueueLevel[a] < t.initQueueLevel[b];
+      }
+      if (t.arrivalTime[a] != t.arrivalTime[b]) {
+        return t.arrivalTime[a] < t.arrivalTime[b];
+      }
+      return a < b;
+    }
+};
+
+/* ordering for the EDF queues: the process with the earliest deadline first (those without one last), and
+   among those, the one that joined the queue first */
+class DeadlineLess {
+  public:
+    bool operator() (const ProcessTable& t, Handle a, Handle b) const {
+      if (t.deadline[a] != t.deadline[b]) {
+        return t.deadline[a] < t.deadline[b];
+      }
+      if (t.currArrivalTime[a] != t.currArrivalTime[b]) {
+        return t.currArrivalTime[a] < t.currArrivalTime[b];
+      }
+      return a < b;
+    }
+};
+
+/* ordering for the fair-share queues: the process that has had the least CPU time for its weight first */
+class VruntimeLess {
+  public:
+    bool operator() (const ProcessTable& t, Handle a, Handle b) const {
+      if (t.vruntime[a] != t.vruntime[b]) {
+        return t.vruntime[a] < t.vruntime[b];
+      }
+      if (t.currArrivalTime[a] != t.currArrivalTime[b]) {
+        return t.currArrivalTime[a] < t.currArrivalTime[b];
+      }
+      return a < b;
+    }
+};
+
+/* a pairing heap of processes by virtual runtime, which keeps the smallest virtual runtime it has run so
+   that a process joining it (on arrival, after I/O or after being upgraded) starts from there, rather than
+   from the little virtual runtime it has, which would let it monopolise the CPU */
+class VruntimeQueue : public HandlePairingHeap <VruntimeLess> {
+  public:
+    double minVruntime;   /* the virtual runtime of the process last taken out to run (never decreasing) */
+
+    VruntimeQueue() {
+      minVruntime = 0;
+    }
+
+    void push(ProcessTable& t, Handle x) {
+      if (t.vruntime[x] < minVruntime) {
+        t.vruntime[x] = minVruntime;
+      }
+      HandlePairingHeap <VruntimeLess>::push(t, x);
+    }
+
+    Handle pop(ProcessTable& t) {
+      Handle x = HandlePairingHeap <VruntimeLess>::pop(t);
+      if (t.vruntime[x] > minVruntime) {
+        minVruntime = t.vruntime[x];
+      }
+      return x;
+    }
+
+    void snapshot(Snapshot& s) {
+      HandlePairingHeap <VruntimeLess>::snapshot(s);
+      s.raw(minVruntime);
+    }
+};
+
+/* ordering for the aging index: the process that will have waited for longer than the threshold first
+   (all the processes in the index are subject to the same threshold) */
+class AgingLess {
+  public:
+    bool operator() (const ProcessTable& t, Handle a, Handle b) const {
+      if (t.currArrivalTime[a] != t.currArrivalTime[b]) {
+        return t.currArrivalTime[a] < t.currArrivalTime[b];
+      }
+      return a < b;
+    }
+};
+
+/* ordering for the stride queues: the process with the smallest pass first */
+class PassLess {
+  public:
+    bool operator() (const ProcessTable& t, Handle a, Handle b) const {
+      if (t.pass[a] != t.pass[b]) {
+        return t.pass[a] < t.pass[b];
+      }
+      if (t.currArrivalTime[a] != t.currArrivalTime[b]) {
+        return t.currArrivalTime[a] < t.currArrivalTime[b];
+      }
+      return a < b;
+    }
+};
+
+/* a pairing heap of processes by pass, for stride scheduling: a process's pass advances by its stride
+   (STRIDE1 over its tickets) for each ms it runs, and a process joining the heap starts from no less than
+   the pass of the process last taken from its top, so that it can't make up for the time it wasn't in the
+   level */
+class StrideQueue : public HandlePairingHeap <PassLess> {
+  public:
+    double globalPass;    /* the pass of the process last taken from the top (never decreasing) */
+
+    StrideQueue() {
+      globalPass = 0;
+    }
+
+    void push(ProcessTable& t, Handle x) {
+      if (t.pass[x] < globalPass) {
+        t.pass[x] = globalPass;
+      }
+      HandlePairingHeap <PassLess>::push(t, x);
+    }
+
+    void remove(ProcessTable& t, Handle x) {
+      if (x == root && t.pass[x] > globalPass) {
+        globalPass = t.pass[x];
+      }
+      HandlePairingHeap <PassLess>::remove(t, x);
+    }
+
+    Handle pop(ProcessTable& t) {
+      Handle x = root;
+      remove(t, x);
+      return x;
+    }
+
+    void snapshot(Snapshot& s) {
+      HandlePairingHeap <PassLess>::snapshot(s);
+      s.raw(globalPass);
+    }
+};
+
+/* the processes of a lottery level: each process has a slot (kept in heapPos), and a Fenwick tree over the
+   tickets of the slots gives the prefix sums of the tickets, so that the winner of a draw from all the
+   tickets, and the addition or removal of a process, take O(log n); the winner is drawn when the top of the
+   queue is first asked for, and stands until a process joins or leaves the level */
+class LotteryQueue {
+  public:
+    std::vector <int64_t> tree;       /* the Fenwick tree over the tickets of the slots (1-based) */
+    std::vector <Handle> owner;       /* the process in each slot (NIL_HANDLE if it is free) */
+    std::vector <uint32_t> freeSlots; /* the slots that are free */
+    int64_t total;                    /* the tickets of all the processes in the level */
+    long count;                       /* the number of processes in the level */
+    uint64_t seed;                    /* the seed the draws start from */
+    Rng rng;                          /* the random number generator the draws are made with */
+    Handle drawn;                     /* the winner of the current draw (NIL_HANDLE if none has been drawn) */
+
+    LotteryQueue() {
+      total = 0;
+      count = 0;
+      reseed(1);
+      drawn = NIL_HANDLE;
+    }
+
+    /* to start the draws over from the seed x */
+    void reseed(uint64_t x) {
+      seed = x;
+      rng.seed(x);
+      drawn = NIL_HANDLE;
+    }
+
+    int empty() const { return count == 0; }
+    long size() const { return count; }
+
+    /* to add delta tickets to slot i (0-based) */
+    void add(uint32_t i, int64_t delta) {
+      size_t n = owner.size();
+      size_t k;
+      for (k = i + 1; k <= n; k += k & -k) {
+        tree[k] += delta;
+      }
+    }
+
+    /* to double the number of slots, building the tree over them again in O(n) */
+    void grow(const ProcessTable& t) {
+      size_t old = owner.size();
+      size_t n = (old == 0) ? 64 : 2*old;
+      owner.resize(n, NIL_HANDLE);
+      tree.assign(n + 1, 0);
+      size_t k;
+      for (k = n; k > old; k--) {
+        freeSlots.push_back(k - 1);
+      }
+      for (k = 1; k <= n; k++) {
+        if (owner[k - 1] != NIL_HANDLE) {
+          tree[k] += t.tickets[owner[k - 1]];
+        }
+        size_t up = k + (k & -k);
+        if (up <= n) {
+          tree[up] += tree[k];
+        }
+      }
+    }
+
+    void push(ProcessTable& t, Handle x) {
+      if (freeSlots.empty()) {
+        grow(t);
+      }
+      uint32_t i = freeSlots.back();
+      freeSlots.pop_back();
+      owner[i] = x;
+      t.heapPos[x] = i;
+      add(i, t.tickets[x]);
+      total += t.tickets[x];
+      count++;
+      drawn = NIL_HANDLE;
+    }
+
+    void remove(ProcessTable& t, Handle x) {
+      uint32_t i = t.heapPos[x];
+      add(i, -(int64_t) t.tickets[x]);
+      total -= t.tickets[x];
+      owner[i] = NIL_HANDLE;
+      freeSlots.push_back(i);
+      t.heapPos[x] = NIL_HANDLE;
+      count--;
+      drawn = NIL_HANDLE;
+    }
+
+    /* the winner of the draw: the process whose tickets take in a ticket drawn at random, found by going
+       down the Fenwick tree */
+    Handle top() {
+      if (drawn == NIL_HANDLE) {
+        int64_t r = (int64_t) (rng.next() % (uint64_t) total);
+        size_t n = owner.size();
+        size_t pos = 0;
+        size_t step;
+        for (step = 1; 2*step <= n; step *= 2) {
+        }
+        for (; step > 0; step /= 2) {
+          if (pos + step <= n && tree[pos + step] <= r) {
+            pos += step;
+            r -= tree[pos];
+          }
+        }
+        drawn = owner[pos];
+      }
+      return drawn;
+    }
+
+    Handle pop(ProcessTable& t) {
+      Handle x = top();
+      remove(t, x);
+      return x;
+    }
+
+    void snapshot(Snapshot& s) {
+      s.vec(tree);
+      s.vec(owner);
+      s.vec(freeSlots);
+      s.raw(total);
+      s.raw(count);
+      s.raw(seed);
+      s.raw(rng.s);
+      s.raw(drawn);
+    }
+};
+
+/* the scheduling policies that a queue level can follow; each one is a type that supplies the container the
+   level keeps its processes in, so that a level's policy is fixed at compile time and picking a process
+   involves no virtual calls */
+
+/* Round Robin: processes are run in the order in which they joined the queue, for at most a time quantum at
+   a time, after which they go back to the tail of the queue */
+class RRPolicy {
+  public:
+    typedef HandleList Container;
+    static const int timeSliced = 1;
+    static const int remainingFirst = 0;
+    static const char* name() { return "rr"; }
+};
+
+/* First Come First Served: processes are run to completion in the order in which they joined the queue */
+class FCFSPolicy {
+  public:
+    typedef HandleList Container;
+    static const int timeSliced = 0;
+    static const int remainingFirst = 0;
+    static const char* name() { return "fcfs"; }
+};
+
+/* Shortest Job First: the process with the shortest burst time is run to completion (or, in preemptive
+   mode, until a process with a shorter burst left joins the level, as for SRTF) */
+class SJFPolicy {
+  public:
+    typedef HandlePairingHeap <BurstLess> Container;
+    static const int timeSliced = 0;
+    static const int remainingFirst = 0;
+    static const char* name() { return "sjf"; }
+};
+
+/* Shortest Remaining Time First: the process with the least burst time left is run, until a process with
+   less burst time left than it joins the level (in preemptive mode or not; without preemption this would
+   just be SJF, so exec mode, which can't preempt, doesn't take SRTF levels); burstTime holds the time left,
+   so the queue is ordered as for SJF */
+class SRTFPolicy {
+  public:
+    typedef HandlePairingHeap <BurstLess> Container;
+    static const int timeSliced = 0;
+    static const int remainingFirst = 1;
+    static const char* name() { return "srtf"; }
+};
+
+/* static priority: the process with the highest priority (see PriorityLess) is run to completion */
+class PriorityPolicy {
+  public:
+    typedef HandleHeap <PriorityLess, &ProcessTable::heapPos> Container;
+    static const int timeSliced = 0;
+    static const int remainingFirst = 0;
+    static const char* name() { return "prio"; }
+};
+
+/* Earliest Deadline First: the process with the earliest deadline is run to completion (or, in preemptive
+   mode, until a process with an earlier deadline joins the level) */
+class EDFPolicy {
+  public:
+    typedef HandlePairingHeap <DeadlineLess> Container;
+    static const int timeSliced = 0;
+    static const int remainingFirst = 0;
+    static const char* name() { return "edf"; }
+};
+
+/* Completely Fair Scheduling: the process that has had the least CPU time for its weight (its virtual runtime)
+   is run for a time quantum, after which it goes back into the queue, so that under overload each process
+   gets CPU time in proportion to its weight */
+class CFSPolicy {
+  public:
+    typedef VruntimeQueue Container;
+    static const int timeSliced = 1;
+    static const int remainingFirst = 0;
+    static const char* name() { return "cfs"; }
+};
+
+/* lottery scheduling: the process holding a ticket drawn at random from all the tickets of the processes in
+   the level is run for a time quantum, after which it goes back into the level, so that on average each
+   process gets CPU time in proportion to its tickets */
+class LotteryPolicy {
+  public:
+    typedef LotteryQueue Container;
+    static const int timeSliced = 1;
+    static const int remainingFirst = 0;
+    static const char* name() { return "lottery"; }
+};
+
+/* stride scheduling: the deterministic counterpart of lottery scheduling; the process with the smallest pass
+   is run for a time quantum, and its pass advances by a stride inversely proportional to its tickets */
+class StridePolicy {
+  public:
+    typedef StrideQueue Container;
+    static const int timeSliced = 1;
+    static const int remainingFirst = 0;
+    static const char* name() { return "stride"; }
+};
+
+/* to put a process that was taken off the CPU before it was done back into the queue q: at the head of a
+   FIFO queue, where it was before it ran, and by its keys into any other */
+inline void pushBack(HandleList& q, ProcessTable& t, Handle h) { q.pushFront(t, h); }
+template <class Container>
+void pushBack(Container& q, ProcessTable& t, Handle h) { q.push(t, h); }
+
+/* a queue level of the multi-level feedback queue, following the scheduling policy Policy */
+template <class Policy>
+class Level {
+  public:
+    typename Policy::Container q;   /* the processes waiting in this level */
+    int quantum;                    /* the time quantum, for time-sliced policies */
+
+    int empty() const { return q.empty(); }
+    long size() const { return q.size(); }
+    const char* name() const { return Policy::name(); }
+    int timeSliced() const { return Policy::timeSliced; }
+    int fifo() const { return std::is_same <typename Policy::Container, HandleList>::value; }
+
+    /* the share of the CPU the process h is entitled to, relative to the others in this level: its weight,
+       for CFS, its tickets, for lottery and stride, and the same for every process otherwise */
+    double entitlement(const ProcessTable& t, Handle h) const {
+      if (std::is_same <Policy, CFSPolicy>::value) {
+        return t.weight[h];
+      }
+      if (std::is_same <Policy, LotteryPolicy>::value || std::is_same <Policy, StridePolicy>::value) {
+        return t.tickets[h];
+      }
+      return 1;
+    }
+
+    /* whether the process h, joining this level, should preempt the process running from it, which has
+       run for ran ms of its slice: if it has less burst left, for SRTF (and for SJF in preemptive mode),
+       an earlier deadline, for EDF in preemptive mode, or, for CFS in preemptive mode, less virtual runtime
+       by more than half a quantum (so that processes with about the same virtual runtime don't keep
+       preempting each other) */
+    int preempts(const ProcessTable& t, Handle h, Handle running, double ran, int preemptive) const {
+      if (std::is_same <Policy, EDFPolicy>::value) {
+        return preemptive && t.deadline[h] < t.deadline[running];
+      }
+      if (std::is_same <Policy, CFSPolicy>::value) {
+        return preemptive && t.vruntime[h] + quantum/2.0 < t.vruntime[running] + ran/t.weight[running];
+      }
+      if (Policy::remainingFirst || (preemptive && std::is_same <Policy, SJFPolicy>::value)) {
+        return t.burstTime[h] < t.burstTime[running] - ran;
+      }
+      return 0;
+    }
+    void push(ProcessTable& t, Handle h) { q.push(t, h); }
+
+    /* to put back a process that was taken off the CPU before it was done, ahead of the processes that
+       joined the level after it */
+    void pushBack(ProcessTable& t, Handle h) { ::pushBack(q, t, h); }
+    void remove(ProcessTable& t, Handle h) { q.remove(t, h); }
+
+    /* to take the next process to run out of the level */
+    Handle pop(ProcessTable& t) { return q.pop(t); }
+
+    /* the duration for which a process picked from this level runs before the scheduler gets the CPU back */
+    double sliceFor(const ProcessTable& t, Handle h) const {
+      if (Policy::timeSliced && quantum < t.burstTime[h]) {
+        return quantum;
+      }
+      return t.burstTime[h];
+    }
+
+    /* the quantum is a setting, so it isn't part of the level's state */
+    void snapshot(Snapshot& s) {
+      q.snapshot(s);
+    }
+};
+
+/* a queue level following any one of the scheduling policies */
+typedef std::variant <Level<RRPolicy>, Level<FCFSPolicy>, Level<SJFPolicy>, Level<SRTFPolicy>, Level<PriorityPolicy>, Level<EDFPolicy>, Level<CFSPolicy>, Level<LotteryPolicy>, Level<StridePolicy>> AnyLevel;
+
+/* to create a queue level following the policy with the given name, with time quantum quantum; returns 0
+   if there is no policy by that name */
+template <class Policy>
+int makeLevelIf(const char* name, int quantum, AnyLevel& level) {
+  if (strcmp(name, Policy::name()) != 0) {
+    return 0;
+  }
+  Level<Policy> l;
+  l.quantum = quantum;
+  level = l;
+  return 1;
+}
+
+inline int makeLevel(const char* name, int quantum, AnyLevel& level) {
+  return makeLevelIf<RRPolicy>(name, quantum, level) || makeLevelIf<FCFSPolicy>(name, quantum, level) ||
+         makeLevelIf<SJFPolicy>(name, quantum, level) || makeLevelIf<SRTFPolicy>(name, quantum, level) ||
+         makeLevelIf<PriorityPolicy>(name, quantum, level) || makeLevelIf<EDFPolicy>(name, quantum, level) ||
+         makeLevelIf<CFSPolicy>(name, quantum, level) || makeLevelIf<LotteryPolicy>(name, quantum, level) ||
+         makeLevelIf<StridePolicy>(name, quantum, level);
+}
+
+/* an entry in the scheduler's event queue */
+class Event {
+  public:
+    double time;      /* the time (ms, relative to the start of the run) at which the event occurs */
+    int type;         /* the kind of event, one of the EV_* values */
+    int cpu;          /* the CPU that the event refers to (for the end of a time slice / CPU burst) */
+    long seq;         /* the order in which the event was queued, to break ties between events at the same time */
+    Process p;        /* the process that the event refers to (for arrivals) */
+
+    void snapshot(Snapshot& s) {
+      s.raw(time);
+      s.raw(type);
+      s.raw(cpu);
+      s.raw(seq);
+      p.snapshot(s);
+    }
+};
+
+/* comparator for the event queue, so that the earliest event (and among those, the one queued first) is at the head */
+class EventCompare {
+  public:
+    bool operator() (const Event& e1, const Event& e2) {
+      if (e1.time != e2.time) {
+        return e1.time > e2.time;
+      }
+      return e1.seq > e2.seq;
+    }
+};
+
+/* the cost of switching a CPU from one process to another, charged in the scheduler's clock before the
+   process starts running; given as a comma-separated list of key=value settings:
+     switch=MS     the fixed cost of a context switch
+     refill=MS     the cost of refilling the cache with each KB of the incoming process's working set
+     ws=KB         the working set of a process that does not give its own (default 0)
+     cache=KB      the size of the cache, beyond which a working set costs no more to refill (default none) */
+class CostModel {
+  public:
+    double switchCost;
+    double refillCost;
+    int workingSet;
+    int cacheSize;
+
+    CostModel() {
+      switchCost = 0;
+      refillCost = 0;
+      workingSet = 0;
+      cacheSize = 0;
+    }
+
+    void parse(const char* spec) {
+      char* buf = strdup(spec);
+      char* save;
+      char* tok = strtok_r(buf, ",", &save);
+      while (tok != NULL) {
+        char* val = strchr(tok, '=');
+        if (val == NULL) {
+          std::cout << "Expected cost setting to be key=value, but received " << tok << "\n";
+          exit(0);
+        }
+        *val++ = '\0';
+        if (strcmp(tok, "switch") == 0) {
+          switchCost = atof(val);
+        }
+        else if (strcmp(tok, "refill") == 0) {
+          refillCost = atof(val);
+        }
+        else if (strcmp(tok, "ws") == 0) {
+          workingSet = atoi(val);
+        }
+        else if (strcmp(tok, "cache") == 0) {
+          cacheSize = atoi(val);
+        }
+        else {
+          std::cout << "Incorrect cost setting " << tok << "\n";
+          exit(0);
+        }
+        tok = strtok_r(NULL, ",", &save);
+      }
+      free(buf);
+      if (switchCost < 0 || refillCost < 0 || workingSet < 0 || cacheSize < 0) {
+        std::cout << "Expected the cost settings to be non-negative\n";
+        exit(0);
+      }
+    }
+
+    int enabled() const { return switchCost > 0 || refillCost > 0; }
+
+    /* the cost of refilling the cache with a working set of ws KB (0 for the default) */
+    double refill(int ws) const {
+      if (ws == 0) {
+        ws = workingSet;
+      }
+      if (cacheSize > 0 && ws > cacheSize) {
+        ws = cacheSize;
+      }
+      return ws*refillCost;
+    }
+};
+
+/* the layout of the CPUs into NUMA nodes, the cost of moving a process between CPUs, and the policy by
+   which processes are placed on CPUs with that in mind; given as a comma-separated list of key=value
+   settings:
+     nodes=N            the number of nodes, over which the CPUs are split evenly, in order (default 1)
+     migrate=MS         the cost of running a process on another CPU of the node it last ran on
+     remote=MS          the cost of running a process on a CPU of another node
+     policy=P           strict, soft (the default) or local
+     slack=N            how many more processes than the least loaded CPU (on the node, for local) the
+                        CPU a process last ran on can have and still take it back (default 2) */
+class Topology {
+  public:
+    int on;                 /* whether the scheduler keeps track of where processes last ran */
+    int nodes;
+    double migrateCost;
+    double remoteCost;
+    int policy;             /* one of the PLACE_* values */
+    long slack;
+
+    Topology() {
+      on = 0;
+      nodes = 1;
+      migrateCost = 0;
+      remoteCost = 0;
+      policy = PLACE_SOFT;
+      slack = 2;
+    }
+
+    void parse(const char* spec) {
+      char* buf = strdup(spec);
+      char* save;
+      char* tok = strtok_r(buf, ",", &save);
+      while (tok != NULL) {
+        char* val = strchr(tok, '=');
+        if (val == NULL) {
+          std::cout << "Expected placement setting to be key=value, but received " << tok << "\n";
+          exit(0);
+        }
+        *val++ = '\0';
+        if (strcmp(tok, "nodes") == 0) {
+          nodes = atoi(val);
+        }
+        else if (strcmp(tok, "migrate") == 0) {
+          migrateCost = atof(val);
+        }
+        else if (strcmp(tok, "remote") == 0) {
+          remoteCost = atof(val);
+        }
+        else if (strcmp(tok, "policy") == 0) {
+          if (strcmp(val, "strict") == 0) {
+            policy = PLACE_STRICT;
+          }
+          else if (strcmp(val, "soft") == 0) {
+            policy = PLACE_SOFT;
+          }
+          else if (strcmp(val, "local") == 0) {
+            policy = PLACE_LOCAL;
+          }
+          else {
+            std::cout << "Expected placement policy to be one of strict, soft, local, but received " << val << "\n";
+            exit(0);
+          }
+        }
+        else if (strcmp(tok, "slack") == 0) {
+          slack = atol(val);
+        }
+        else {
+          std::cout << "Incorrect placement setting " << tok << "\n";
+          exit(0);
+        }
+        tok = strtok_r(NULL, ",", &save);
+      }
+      free(buf);
+      if (nodes < 1 || migrateCost < 0 || remoteCost < 0 || slack < 0) {
+        std::cout << "Expected at least 1 node, and the costs and slack to be non-negative\n";
+        exit(0);
+      }
+      on = 1;
+    }
+
+    const char* policyName() const {
+      return (policy == PLACE_STRICT) ? "strict" : (policy == PLACE_SOFT) ? "soft" : "local";
+    }
+};
+
+/* the hierarchy of groups (tenants) that processes are scheduled on behalf of, each with a number of shares of
+   the CPU that it splits with its sibling groups; given as a comma-separated list of PATH=SHARES settings,
+   such as web=3,web/api=2,web/static=1,batch=1, in which a group must come before its subgroups; processes
+   belong to the groups without subgroups, and those that don't give one to the group "default" (with 1
+   share, unless given), directly under the root */
+class GroupTree {
+  public:
+    std::vector <std::string> name;           /* the path of each group ("" for the root) */
+    std::vector <int> parent;                 /* the group each group is a subgroup of (-1 for the root) */
+    std::vector <double> shares;              /* the shares of each group */
+    std::vector <std::vector<int>> children;  /* the subgroups of each group */
+
+    GroupTree() {
+      add("", -1, 1);
+      add("default", ROOT_GROUP, 1);
+    }
+
+    int size() const { return name.size(); }
+    int leaf(int g) const { return children[g].empty(); }
+
+    /* to add the group path under the group p, returning its index */
+    int add(const std::string& path, int p, double s) {
+      name.push_back(path);
+      parent.push_back(p);
+      shares.push_back(s);
+      children.push_back(std::vector<int>());
+      if (p >= 0) {
+        children[p].push_back(name.size() - 1);
+      }
+      return name.size() - 1;
+    }
+
+    /* the index of the group path (-1 if there is none) */
+    int find(const char* path) const {
+      int g;
+      for (g = 0; g < size(); g++) {
+        if (name[g] == path) {
+          return g;
+        }
+      }
+      return -1;
+    }
+
+    /* the index of the group path that a process belongs to, which must be a group without subgroups */
+    int findLeaf(const char* path) const {
+      int g = find(path);
+      if (g < 0 || !leaf(g)) {
+        std::cout << "Expected a process's group to be one without subgroups, given with -H, but received " << path << "\n";
+        exit(0);
+      }
+      return g;
+    }
+
+    void parse(const char* spec) {
+      char* buf = strdup(spec);
+      char* save;
+      char* tok = strtok_r(buf, ",", &save);
+      while (tok != NULL) {
+        char* val = strchr(tok, '=');
+        double s = (val != NULL) ? atof(val + 1) : 0;
+        if (val == NULL || s <= 0) {
+          std::cout << "Expected group to be PATH=SHARES, with positive shares, but received " << tok << "\n";
+          exit(0);
+        }
+        *val = '\0';
+        int g = find(tok);
+        if (g > ROOT_GROUP) {
+          shares[g] = s;
+        }
+        else {
+          char* slash = strrchr(tok, '/');
+          int p = ROOT_GROUP;
+          if (slash != NULL) {
+            std::string parentPath(tok, slash - tok);
+            p = find(parentPath.c_str());
+            if (p < 0 || p == DEFAULT_GROUP) {
+              std::cout << "Expected group " << parentPath << " to be given before its subgroup " << tok << "\n";
+              exit(0);
+            }
+          }
+          if (size() == MAX_GROUPS) {
+            std::cout << "Expected at most " << MAX_GROUPS << " groups\n";
+            exit(0);
+          }
+          add(tok, p, s);
+        }
+        tok = strtok_r(NULL, ",", &save);
+      }
+      free(buf);
+    }
+};
+
+/* a change that the quantum controller made to the time quantum of the first level */
+class QuantumChange {
+  public:
+    double time;                /* when the quantum was changed */
+    int from;                   /* the quantum before */
+    int to;                     /* the quantum after */
+    double percentile;          /* the percentile of the recent bursts that the change followed */
+};
+
+/* the controller that retunes the time quantum of the first level as a run goes on, keeping it at a
+   percentile of the most recent CPU bursts, so that about that share of the bursts finish within one
+   quantum and the rest are demoted; given as a comma-separated list of key=value settings:
+     pct=P         the percentile of the recent bursts to keep the quantum at (default 80)
+     window=N      the number of most recent bursts that the percentile is taken over (default 200)
+     every=N       the number of bursts between retunings (default a quarter of the window)
+     band=PCT      how far (%) the percentile has to move from the quantum before it is retuned, so that
+                   the quantum doesn't flap back and forth on noise (default 10)
+     min=MS        the least quantum (default 1)
+     max=MS        the greatest quantum (default 100) */
+class QuantumTuner {
+  public:
+    int on;                                 /* whether the quantum is retuned */
+    double pct;
+    int window;
+    int every;
+    double band;
+    int minQuantum;
+    int maxQuantum;
+    std::vector <double> recent;            /* the lengths of the most recent bursts, as a ring */
+    std::vector <double> scratch;           /* a copy of them to take the percentile of */
+    long seen;                              /* the number of bursts seen so far */
+    std::vector <QuantumChange> changes;    /* the changes made to the quantum, in order */
+
+    QuantumTuner() {
+      on = 0;
+      pct = 80;
+      window = 200;
+      every = 0;
+      band = 10;
+      minQuantum = 1;
+      maxQuantum = 100;
+      seen = 0;
+    }
+
+    void parse(const char* spec) {
+      char* buf = strdup(spec);
+      char* save;
+      char* tok = strtok_r(buf, ",", &save);
+      while (tok != NULL) {
+        char* val = strchr(tok, '=');
+        if (val == NULL) {
+          std::cout << "Expected quantum setting to be key=value, but received " << tok << "\n";
+          exit(0);
+        }
+        *val++ = '\0';
+        if (strcmp(tok, "pct") == 0) {
+          pct = atof(val);
+        }
+        else if (strcmp(tok, "window") == 0) {
+          window = atoi(val);
+        }
+        else if (strcmp(tok, "every") == 0) {
+          every = atoi(val);
+        }
+        else if (strcmp(tok, "band") == 0) {
+          band = atof(val);
+        }
+        else if (strcmp(tok, "min") == 0) {
+          minQuantum = atoi(val);
+        }
+        else if (strcmp(tok, "max") == 0) {
+          maxQuantum = atoi(val);
+        }
+        else {
+          std::cout << "Incorrect quantum setting " << tok << "\n";
+          exit(0);
+        }
+        tok = strtok_r(NULL, ",", &save);
+      }
+      free(buf);
+      if (pct <= 0 || pct > 100 || window < 1 || every < 0 || band < 0 || minQuantum < 1 || maxQuantum < minQuantum) {
+        std::cout << "Expected pct in (0, 100], a positive window and every, a non-negative band, and 1 <= min <= max\n";
+        exit(0);
+      }
+      if (every == 0) {
+        every = (window >= 4) ? window/4 : 1;
+      }
+      recent.assign(window, 0);
+      on = 1;
+    }
+
+    /* to take note of a CPU burst of len ms that finished at time t, while the quantum was quantum;
+       returns the quantum to use from now on */
+    int observe(double len, double t, int quantum) {
+      recent[seen % window] = len;
+      seen++;
+      if (seen % every != 0) {
+        return quantum;
+      }
+      long n = (seen < window) ? seen : window;
+      scratch.assign(recent.begin(), recent.begin() + n);
+      long k = (long) ceil(pct/100*n) - 1;
+      if (k < 0) {
+        k = 0;
+      }
+      std::nth_element(scratch.begin(), scratch.begin() + k, scratch.end());
+      double target = scratch[k];
+      if (fabs(target - quantum) <= quantum*band/100) {
+        return quantum;
+      }
+      int q = (int) ceil(target);
+      if (q < minQuantum) {
+        q = minQuantum;
+      }
+      if (q > maxQuantum) {
+        q = maxQuantum;
+      }
+      if (q != quantum) {
+        QuantumChange ch;
+        ch.time = t;
+        ch.from = quantum;
+        ch.to = q;
+        ch.percentile = target;
+        changes.push_back(ch);
+      }
+      return q;
+    }
+
+    void snapshot(Snapshot& s) {
+      s.check(on ? window : 0, "adaptive quantum window");
+      s.vec(recent);
+      s.raw(seen);
+      s.vec(changes);
+    }
+};
+
+/* to read the current wall clock time, in ms */
+inline double wallTime() {
+  struct timeval temp_time;
+  gettimeofday(&temp_time, NULL);
+  return (temp_time.tv_sec * 1000000 + temp_time.tv_usec + 0.0)/1000;
+}
+
+/* the clock that the scheduler runs against; in real mode a process "runs on the CPU" by sleeping,
+   and time is read from the wall clock, whereas in simulated mode time is a virtual clock that jumps
+   straight to the next event, so a run is deterministic and takes no longer than its bookkeeping */
+class Clock {
+  public:
+    int simulated;    /* 1 for the virtual clock, 0 for the wall clock */
+    double start;     /* the wall clock time (ms) at which the run started (0 in simulated mode) */
+    double now;       /* the current time, in ms relative to start */
+
+    /* to start the clock at time 0 */
+    void begin() {
+      now = 0;
+      start = simulated ? 0 : wallTime();
+    }
+
+    /* to read the current time */
+    double read() {
+      if (!simulated) {
+        now = wallTime() - start;
+      }
+      return now;
+    }
+
+    /* to move the clock forward to time t, returning the time actually reached; in real mode this
+       sleeps until t, and may overshoot it by the usual scheduling noise */
+    double advanceTo(double t) {
+      if (simulated) {
+        if (t > now) {
+          now = t;
+        }
+        return now;
+      }
+      double d = t - read();
+      if (d > 0) {
+        usleep((useconds_t) (d*1000));
+      }
+      return read();
+    }
+};
+
+/* a source of arriving processes, which gives them out in non-decreasing order of arrival time */
+class ProcessSource {
+  public:
+    /* to get the next process to arrive into p; returns 0 once there are no more */
+    virtual int next(Process& p) = 0;
+    /* to save how far through its processes the source is, or to pick up from there */
+    virtual void snapshot(Snapshot& s) = 0;
+    virtual ~ProcessSource() {}
+};
+
+/* reads the processes from the input file one at a time, in chunks of TRACE_CHUNK_SIZE bytes, so that
+   a trace of any size can be replayed in bounded memory; each line of the file holds the process ID,
+   its initial queue level, its burst time and, optionally, its arrival time (0 if absent), and the
+   lines must be in non-decreasing order of arrival time */
+class TraceReader : public ProcessSource {
+  public:
+    const char* fileName;   /* the name of the input file */
+    int fd;                 /* the file descriptor of the input file */
+    char* buf;              /* the chunk of the file currently being parsed */
+    size_t len;             /* the number of bytes in buf */
+    size_t pos;             /* the position in buf up to which lines have been parsed */
+    int eof;                /* whether the whole file has been read into buf */
+    long lineNo;            /* the number of lines read so far */
+    double lastArrival;     /* the arrival time of the last process read */
+    int numLevels;          /* the number of queue levels a process may be assigned to */
+    int numDevices;         /* the number of devices a process may make I/O requests to */
+    const GroupTree* groups;   /* the groups a process may belong to */
+
+    /* to open the input file */
+    void open(const char* fn, int levels, int devices, const GroupTree* gt) {
+      fileName = fn;
+      fd = ::open(fn, O_RDONLY);
+
+      /* checking for any error in opening the file */
+      if (fd < 0) {
+        printf("Error in opening file %s\n", fn);
+        exit(1);
+      }
+      buf = (char*) malloc(TRACE_CHUNK_SIZE + 1);
+      len = 0;
+      pos = 0;
+      eof = 0;
+      lineNo = 0;
+      lastArrival = 0;
+      numLevels = levels;
+      numDevices = devices;
+      groups = gt;
+    }
+
+    /* to close the input file */
+    void close() {
+      ::close(fd);
+      free(buf);
+    }
+
+    /* the file is picked up from the start of the first line that hasn't been parsed */
+    void snapshot(Snapshot& s) override {
+      int64_t offset = lseek(fd, 0, SEEK_CUR) - (int64_t) (len - pos);
+      s.raw(offset);
+      s.raw(lineNo);
+      s.raw(lastArrival);
+      if (s.loading) {
+        lseek(fd, offset, SEEK_SET);
+        len = 0;
+        pos = 0;
+        eof = 0;
+      }
+    }
+
+    /* to move the unparsed tail of the chunk to the front of buf, and fill the rest of it from the file */
+    void fill() {
+      memmove(buf, buf + pos, len - pos);
+      len -= pos;
+      pos = 0;
+      while (len < TRACE_CHUNK_SIZE) {
+        ssize_t n = read(fd, buf + len, TRACE_CHUNK_SIZE - len);
+        if (n <= 0) {
+          eof = 1;
+          break;
+        }
+        len += n;
+      }
+    }
+
+    /* to read the next process from the file into p; returns 0 once the whole file has been read */
+    int next(Process& p) override {
+      while (1) {
+        /* finding the end of the next line, reading in the next chunk if it isn't in this one */
+        char* nl = (char*) memchr(buf + pos, '\n', len - pos);
+        if (nl == NULL && !eof) {
+          fill();
+          nl = (char*) memchr(buf + pos, '\n', len - pos);
+          if (nl == NULL && len == TRACE_CHUNK_SIZE) {
+            std::cout << "Line " << lineNo + 1 << " of " << fileName << " is longer than " << TRACE_CHUNK_SIZE << " bytes\n";
+            exit(0);
+          }
+        }
+        if (pos >= len) {
+          return 0;
+        }
+        if (nl == NULL) {
+          nl = buf + len;
+        }
+        *nl = '\0';
+        char* line = buf + pos;
+        pos = (nl - buf) + 1;
+        lineNo++;
+
+        /* parsing the different fields of the process from the line */
+        double arr[4];
+        int i = 0;
+        char* ptr = line;
+        p.phases.clear();
+        while (i < 4) {
+          char* end;
+          arr[i] = strtod(ptr, &end);
+          if (end == ptr) {
+            break;
+          }
+          ptr = end;
+          i++;
+          /* the burst field may go on into a sequence of I/O requests and CPU bursts */
+          if (i == 3 && *ptr == '/') {
+            ptr = parsePhases(ptr, p);
+          }
+        }
+        /* skipping blank lines */
+        if (i == 0) {
+          continue;
+        }
+        if (i < 3) {
+          std::cout << "Expected at least 3 fields on line " << lineNo << " of " << fileName << ", but received " << i << "\n";
+          exit(0);
+        }
+        p.id = (int) arr[0];
+        p.initQueueLevel = (int) arr[1];
+        p.currQueueLevel = (int) arr[1];
+        p.burstTime = (int) arr[2];
+        p.arrivalTime = (i == 4) ? arr[3] : 0;
+        p.currArrivalTime = p.arrivalTime;
+        parseFields(ptr, p);
+        if (p.initQueueLevel < 1 || p.initQueueLevel > numLevels) {
+          std::cout << "Invalid\n";
+          exit(0);
+        }
+        if (p.arrivalTime < lastArrival) {
+          std::cout << "Expected arrival times in non-decreasing order, but process " << p.id << " on line " << lineNo << " arrives at " << p.arrivalTime << ", before " << lastArrival << "\n";
+          exit(0);
+        }
+        lastArrival = p.arrivalTime;
+        return 1;
+      }
+    }
+
+    /* to parse the optional key=value fields after the positional ones on a line into p:
+         ws=KB          the size of the process's working set
+         deadline=MS    the time, after its arrival, by which the process should finish
+         weight=W       the process's share of the CPU relative to others, in a fair-share level
+         tickets=T      the process's tickets, in lottery and stride levels
+         group=PATH     the group the process is scheduled on behalf of */
+    void parseFields(char* ptr, Process& p) {
+      p.workingSet = 0;
+      p.deadline = INFINITY;
+      p.weight = 1;
+      p.tickets = DEFAULT_TICKETS;
+      p.group = DEFAULT_GROUP;
+      while (1) {
+        ptr += strspn(ptr, " \t\r");
+        if (*ptr == '\0') {
+          break;
+        }
+        char* key = ptr;
+        ptr += strcspn(ptr, " \t\r");
+        if (*ptr != '\0') {
+          *ptr++ = '\0';
+        }
+        char* val = strchr(key, '=');
+        if (val == NULL) {
+          std::cout << "Expected a key=value field on line " << lineNo << " of " << fileName << ", but received " << key << "\n";
+          exit(0);
+        }
+        *val++ = '\0';
+        if (strcmp(key, "ws") == 0) {
+          p.workingSet = atoi(val);
+        }
+        else if (strcmp(key, "deadline") == 0) {
+          p.deadline = p.arrivalTime + atof(val);
+        }
+        else if (strcmp(key, "group") == 0) {
+          p.group = groups->findLeaf(val);
+        }
+        else if (strcmp(key, "weight") == 0) {
+          p.weight = atof(val);
+          if (p.weight <= 0) {
+            std::cout << "Expected a positive weight on line " << lineNo << " of " << fileName << ", but received " << val << "\n";
+            exit(0);
+          }
+        }
+        else if (strcmp(key, "tickets") == 0) {
+          long tickets = atol(val);
+          if (tickets < 1 || tickets > UINT32_MAX) {
+            std::cout << "Expected a positive number of tickets on line " << lineNo << " of " << fileName << ", but received " << val << "\n";
+            exit(0);
+          }
+          p.tickets = tickets;
+        }
+        else {
+          std::cout << "Unknown field " << key << " on line " << lineNo << " of " << fileName << "\n";
+          exit(0);
+        }
+      }
+    }
+
+    /* to parse the rest of a burst sequence such as 30/io1/20/io2:15/5 (a CPU burst of 30, an I/O request
+       to device 1 for its service time, a CPU burst of 20, an I/O request to device 2 for 15, and a last
+       CPU burst of 5) into the phases of p, starting at the '/' after the first burst; returns the position
+       after the sequence */
+    char* parsePhases(char* ptr, Process& p) {
+      while (*ptr == '/') {
+        BurstPhase ph;
+        char* end;
+        if (strncmp(ptr + 1, "io", 2) != 0) {
+          std::cout << "Expected an I/O request (ioN or ioN:TIME) after a CPU burst on line " << lineNo << " of " << fileName << "\n";
+          exit(0);
+        }
+        ph.device = strtol(ptr + 3, &end, 10);
+        if (end == ptr + 3 || ph.device < 1 || ph.device > numDevices) {
+          std::cout << "Expected the device on line " << lineNo << " of " << fileName << " to be in the range 1 - " << numDevices << "\n";
+          exit(0);
+        }
+        ptr = end;
+        ph.ioTime = -1;
+        if (*ptr == ':') {
+          ph.ioTime = strtol(ptr + 1, &end, 10);
+          if (end == ptr + 1 || ph.ioTime < 0) {
+            std::cout << "Expected an I/O time after ':' on line " << lineNo << " of " << fileName << "\n";
+            exit(0);
+          }
+          ptr = end;
+        }
+        ph.cpuTime = 0;
+        if (*ptr == '/') {
+          ph.cpuTime = strtol(ptr + 1, &end, 10);
+          if (end == ptr + 1 || ph.cpuTime < 1) {
+            std::cout << "Expected a CPU burst after an I/O request on line " << lineNo << " of " << fileName << "\n";
+            exit(0);
+          }
+          ptr = end;
+        }
+        p.phases.push_back(ph);
+        if (ph.cpuTime == 0) {
+          break;
+        }
+      }
+      return ptr;
+    }
+};
+
+#define DIST_EXP     0    /* exponential, with mean a */
+#define DIST_BIMODAL 1    /* exponential with mean a, with probability c, or else with mean b */
+#define DIST_PARETO  2    /* Pareto, with shape a and minimum b */
+#define DIST_FIXED   3    /* always a */
+
+#define ARR_POISSON 0     /* a Poisson process, at a processes/sec */
+#define ARR_BURSTY  1     /* batches of b processes on average (geometrically distributed), arriving as a
+                             Poisson process so that a processes/sec arrive overall */
+#define ARR_ZERO    2     /* every process arrives at time 0 */
+
+/* generates a synthetic workload on the fly, from a seed, instead of reading it from an input file; the
+   workload is described by a comma-separated list of key=value settings:
+     n=COUNT                                the number of processes (default 1000)
+     seed=SEED                              the seed of the random number generator (default 1)
+     mix=W1:W2:...                          the relative weights of the initial levels (default 1:1:...:1)
+     burst=exp:MEAN | bimodal:SHORT:LONG:P | pareto:ALPHA:MIN | fixed:MS
+                                            the distribution of burst times, in ms (default exp:20)
+     arrival=poisson:RATE | bursty:RATE:BATCH | zero
+                                            the arrival process, RATE in processes/sec (default poisson:40)
+     io=FRACTION:CYCLES[:MEAN]              the fraction of processes that are I/O-bound: each makes CYCLES
+                                            CPU bursts (exponential, with mean MEAN ms, default 2), with an
+                                            I/O request to a random device after each but the last
+                                            (default 0)
+     ws=KB                                  the mean size of the processes' working sets (exponential;
+                                            default 0, for the cost model's default)
+     deadline=FRACTION:SLACK                the fraction of processes with deadlines, each SLACK times its
+                                            total CPU time after its arrival (default 0)
+     weight=W1:W2:...                       the weights that processes are given, one picked at random
+                                            for each (default 1)
+     tickets=T1:T2:...                      the tickets that processes are given, for lottery and stride
+                                            levels, one picked at random for each (default DEFAULT_TICKETS)
+     group=G1:G2:...                        the groups that processes belong to, one picked at random for
+                                            each (default the default group; list a group more than once
+                                            to give it more of the processes) */
+class WorkloadGenerator : public ProcessSource {
+  public:
+    long count;                     /* the number of processes to generate */
+    long generated;                 /* the number of processes generated so far */
+    uint64_t seed;                  /* the seed the random number generator started from */
+    Rng rng;                        /* the random number generator */
+    std::vector <double> mix;       /* the cumulative weights of the initial levels, normalised to 1 */
+    int burstDist;                  /* the distribution of burst times, one of the DIST_* values */
+    double burstA, burstB, burstC;  /* the parameters of that distribution */
+    int arrivalDist;                /* the arrival process, one of the ARR_* values */
+    double rate;                    /* the mean arrival rate, in processes per ms */
+    double batch;                   /* the mean batch size, for bursty arrivals */
+    long batchLeft;                 /* the number of processes left to arrive in the current batch */
+    double now;                     /* the arrival time of the last process generated */
+    double ioFraction;              /* the fraction of processes that are I/O-bound */
+    int ioCycles;                   /* the number of CPU bursts of an I/O-bound process */
+    double ioCpuMean;               /* the mean CPU burst of an I/O-bound process */
+    int numDevices;                 /* the number of devices I/O requests may go to */
+    double wsMean;                  /* the mean working set size, in KB (0 to leave it to the default) */
+    double deadlineFraction;        /* the fraction of processes with deadlines */
+    double deadlineSlack;           /* how many times its CPU time after its arrival a process's deadline is */
+    std::vector <double> weights;   /* the weights that processes are given (empty for all 1) */
+    std::vector <uint32_t> ticketPicks; /* the tickets that processes are given (empty for DEFAULT_TICKETS) */
+    std::vector <int> groupPicks;   /* the groups that processes are put in (empty for the default group) */
+
+    /* to set up the generator from the settings in spec, for a scheduler with numLevels queue levels,
+       numDevices devices and the groups in gt */
+    void init(const char* spec, int numLevels, int devices, const GroupTree* gt) {
+      count = 1000;
+      generated = 0;
+      seed = 1;
+      burstDist = DIST_EXP;
+      burstA = 20;
+      burstB = 0;
+      burstC = 0;
+      arrivalDist = ARR_POISSON;
+      rate = 40/1000.0;
+      batch = 1;
+      batchLeft = 0;
+      now = 0;
+      ioFraction = 0;
+      ioCycles = 1;
+      ioCpuMean = 2;
+      numDevices = devices;
+      wsMean = 0;
+      deadlineFraction = 0;
+      deadlineSlack = 1;
+      mix.assign(numLevels, 1);
+
+      char* buf = strdup(spec);
+      char* save;
+      char* tok = strtok_r(buf, ",", &save);
+      while (tok != NULL) {
+        char* val = strchr(tok, '=');
+        if (val == NULL) {
+          std::cout << "Expected workload setting to be key=value, but received " << tok << "\n";
+          exit(0);
+        }
+        *val++ = '\0';
+        if (strcmp(tok, "n") == 0) {
+          count = atol(val);
+        }
+        else if (strcmp(tok, "seed") == 0) {
+          seed = strtoull(val, NULL, 10);
+        }
+        else if (strcmp(tok, "mix") == 0) {
+          mix.clear();
+          char* ptr = val;
+          while (*ptr != '\0') {
+            mix.push_back(atof(ptr));
+            ptr += strcspn(ptr, ":");
+            if (*ptr == ':') {
+              ptr++;
+            }
+          }
+          if (mix.empty() || (int) mix.size() > numLevels) {
+            std::cout << "Expected between 1 and " << numLevels << " level weights, but received " << mix.size() << "\n";
+            exit(0);
+          }
+        }
+        else if (strcmp(tok, "burst") == 0) {
+          double a = 0, b = 0, c = 0;
+          if (sscanf(val, "exp:%lf", &a) == 1 && a > 0) {
+            burstDist = DIST_EXP;
+          }
+          else if (sscanf(val, "bimodal:%lf:%lf:%lf", &a, &b, &c) == 3 && a > 0 && b > 0 && c >= 0 && c <= 1) {
+            burstDist = DIST_BIMODAL;
+          }
+          else if (sscanf(val, "pareto:%lf:%lf", &a, &b) == 2 && a > 0 && b > 0) {
+            burstDist = DIST_PARETO;
+          }
+          else if (sscanf(val, "fixed:%lf", &a) == 1 && a >= 1) {
+            burstDist = DIST_FIXED;
+          }
+          else {
+            std::cout << "Expected burst distribution to be one of exp:MEAN, bimodal:SHORT:LONG:P, pareto:ALPHA:MIN, fixed:MS, but received " << val << "\n";
+            exit(0);
+          }
+          burstA = a;
+          burstB = b;
+          burstC = c;
+        }
+        else if (strcmp(tok, "arrival") == 0) {
+          double r = 0, b = 0;
+          if (sscanf(val, "poisson:%lf", &r) == 1 && r > 0) {
+            arrivalDist = ARR_POISSON;
+          }
+          else if (sscanf(val, "bursty:%lf:%lf", &r, &b) == 2 && r > 0 && b >= 1) {
+            arrivalDist = ARR_BURSTY;
+            batch = b;
+          }
+          else if (strcmp(val, "zero") == 0) {
+            arrivalDist = ARR_ZERO;
+          }
+          else {
+            std::cout << "Expected arrival process to be one of poisson:RATE, bursty:RATE:BATCH, zero, but received " << val << "\n";
+            exit(0);
+          }
+          rate = r/1000.0;
+        }
+        else if (strcmp(tok, "ws") == 0) {
+          wsMean = atof(val);
+        }
+        else if (strcmp(tok, "group") == 0) {
+          groupPicks.clear();
+          char* pathSave;
+          char* path = strtok_r(val, ":", &pathSave);
+          while (path != NULL) {
+            groupPicks.push_back(gt->findLeaf(path));
+            path = strtok_r(NULL, ":", &pathSave);
+          }
+        }
+        else if (strcmp(tok, "weight") == 0) {
+          weights.clear();
+          char* ptr = val;
+          while (*ptr != '\0') {
+            double w = atof(ptr);
+            if (w <= 0) {
+              std::cout << "Expected positive weights, but received " << val << "\n";
+              exit(0);
+            }
+            weights.push_back(w);
+            ptr += strcspn(ptr, ":");
+            if (*ptr == ':') {
+              ptr++;
+            }
+          }
+        }
+        else if (strcmp(tok, "tickets") == 0) {
+          ticketPicks.clear();
+          char* ptr = val;
+          while (*ptr != '\0') {
+            long tickets = atol(ptr);
+            if (tickets < 1 || tickets > UINT32_MAX) {
+              std::cout << "Expected positive numbers of tickets, but received " << val << "\n";
+              exit(0);
+            }
+            ticketPicks.push_back(tickets);
+            ptr += strcspn(ptr, ":");
+            if (*ptr == ':') {
+              ptr++;
+            }
+          }
+        }
+        else if (strcmp(tok, "deadline") == 0) {
+          if (sscanf(val, "%lf:%lf", &deadlineFraction, &deadlineSlack) != 2 || deadlineFraction < 0 || deadlineFraction > 1 || deadlineSlack < 1) {
+            std::cout << "Expected deadlines to be FRACTION:SLACK, with a slack of at least 1, but received " << val << "\n";
+            exit(0);
+          }
+        }
+        else if (strcmp(tok, "io") == 0) {
+          if (sscanf(val, "%lf:%d:%lf", &ioFraction, &ioCycles, &ioCpuMean) < 2 || ioFraction < 0 || ioFraction > 1 || ioCycles < 2 || ioCpuMean <= 0) {
+            std::cout << "Expected I/O-bound processes to be FRACTION:CYCLES[:MEAN], with at least 2 cycles, but received " << val << "\n";
+            exit(0);
+          }
+          if (numDevices == 0) {
+            std::cout << "Expected devices (-D) for the I/O-bound processes to make requests to\n";
+            exit(0);
+          }
+        }
+        else {
+          std::cout << "Incorrect workload setting " << tok << "\n";
+          exit(0);
+        }
+        tok = strtok_r(NULL, ",", &save);
+      }
+      free(buf);
+
+      double total = 0;
+      size_t l;
+      for (l = 0; l < mix.size(); l++) {
+        total += mix[l];
+        mix[l] = total;
+      }
+      if (total <= 0) {
+        std::cout << "Expected the level weights to add up to more than 0\n";
+        exit(0);
+      }
+      for (l = 0; l < mix.size(); l++) {
+        mix[l] /= total;
+      }
+      rng.seed(seed);
+    }
+
+    /* to start the workload over from the seed r after the one given, for the r-th of several independent
+       replicas of it */
+    void reseed(uint64_t r) {
+      generated = 0;
+      batchLeft = 0;
+      now = 0;
+      rng.seed(seed + r);
+    }
+
+    /* to draw a burst time, in whole ms (at least 1) */
+    int drawBurst() {
+      double b;
+      switch (burstDist) {
+        case DIST_EXP:
+              b = rng.exponential(burstA);
+              break;
+        case DIST_BIMODAL:
+              b = rng.exponential(rng.uniform() < burstC ? burstA : burstB);
+              break;
+        case DIST_PARETO:
+              b = burstB/pow(rng.uniform(), 1/burstA);
+              break;
+        default:
+              b = burstA;
+              break;
+      }
+      if (b > 1e9) {
+        b = 1e9;
+      }
+      return (b < 1) ? 1 : (int) ceil(b);
+    }
+
+    /* to draw a CPU burst of an I/O-bound process, in whole ms (at least 1) */
+    int drawShortBurst() {
+      double b = rng.exponential(ioCpuMean);
+      return (b < 1) ? 1 : (int) ceil(b);
+    }
+
+    /* to move now on to the arrival time of the next process */
+    void drawArrival() {
+      switch (arrivalDist) {
+        case ARR_POISSON:
+              now += rng.exponential(1/rate);
+              break;
+        case ARR_BURSTY:
+              if (batchLeft == 0) {
+                /* the next batch arrives, with a geometrically distributed number of processes in it */
+                now += rng.exponential(batch/rate);
+                batchLeft = 1 + (long) floor(log(rng.uniform())/log(1 - 1/batch + 1e-12));
+              }
+              batchLeft--;
+              break;
+      }
+    }
+
+    /* the generator picks up from the same point in the same random sequence */
+    void snapshot(Snapshot& s) override {
+      s.check(count, "number of processes to generate");
+      s.raw(generated);
+      s.raw(rng.s);
+      s.raw(batchLeft);
+      s.raw(now);
+    }
+
+    int next(Process& p) override {
+      if (generated == count) {
+        return 0;
+      }
+      if (generated > 0) {
+        drawArrival();
+      }
+      double u = rng.uniform();
+      int l = 0;
+      while (l + 1 < (int) mix.size() && u > mix[l]) {
+        l++;
+      }
+      p.id = generated + 1;
+      p.initQueueLevel = l + 1;
+      p.currQueueLevel = l + 1;
+      p.burstTime = drawBurst();
+      p.arrivalTime = now;
+      p.currArrivalTime = now;
+      p.phases.clear();
+      p.workingSet = (wsMean > 0) ? 1 + (int) rng.exponential(wsMean) : 0;
+      if (ioFraction > 0 && rng.uniform() < ioFraction) {
+        /* an I/O-bound process: short CPU bursts, each but the last followed by an I/O request */
+        p.burstTime = drawShortBurst();
+        int k;
+        for (k = 1; k < ioCycles; k++) {
+          BurstPhase ph;
+          ph.device = 1 + (int) (rng.uniform()*numDevices);
+          ph.ioTime = -1;
+          ph.cpuTime = drawShortBurst();
+          p.phases.push_back(ph);
+        }
+      }
+      p.group = DEFAULT_GROUP;
+      if (!groupPicks.empty()) {
+        p.group = groupPicks[(size_t) (rng.uniform()*groupPicks.size())];
+      }
+      p.weight = 1;
+      if (!weights.empty()) {
+        p.weight = weights[(size_t) (rng.uniform()*weights.size())];
+      }
+      p.tickets = DEFAULT_TICKETS;
+      if (!ticketPicks.empty()) {
+        p.tickets = ticketPicks[(size_t) (rng.uniform()*ticketPicks.size())];
+      }
+      p.deadline = INFINITY;
+      if (deadlineFraction > 0 && rng.uniform() < deadlineFraction) {
+        double cpu = p.burstTime;
+        size_t k;
+        for (k = 0; k < p.phases.size(); k++) {
+          cpu += p.phases[k].cpuTime;
+        }
+        p.deadline = now + deadlineSlack*cpu;
+      }
+      generated++;
+      return 1;
+    }
+};
+
+/* gives out the processes of an input file that has been read into memory, so that several runs of the
+   scheduler can share them */
+class ProcessList : public ProcessSource {
+  public:
+    const std::vector <Process>* procs;   /* the processes, in order of arrival */
+    size_t pos;                           /* the index of the next process to arrive */
+
+    ProcessList(const std::vector<Process>* list) {
+      procs = list;
+      pos = 0;
+    }
+
+    int next(Process& p) override {
+      if (pos == procs->size()) {
+        return 0;
+      }
+      p = (*procs)[pos++];
+      return 1;
+    }
+
+    void snapshot(Snapshot& s) override {
+      s.raw(pos);
+    }
+};
+
+/* a histogram of latencies in the style of HdrHistogram: values (recorded in microseconds) below
+   2^HIST_SUB_BITS each have a bucket of their own, and above that every power of 2 is split into
+   2^HIST_SUB_BITS equal buckets, so that any percentile is within 1% of the exact value */
+class Histogram {
+  public:
+    std::vector <uint64_t> counts;    /* the number of values in each bucket (allocated on the first value) */
+    uint64_t total;                   /* the number of values recorded */
+    double sum;                       /* the sum of the values recorded, in ms */
+    double max;                       /* the largest value recorded, in ms */
+
+    Histogram() {
+      total = 0;
+      sum = 0;
+      max = 0;
+    }
+
+    /* the bucket that a value (in microseconds) falls in */
+    static int bucketOf(uint64_t v) {
+      if (v < (1u << HIST_SUB_BITS)) {
+        return v;
+      }
+      int shift = 63 - __builtin_clzll(v) - HIST_SUB_BITS;
+      return ((shift + 1) << HIST_SUB_BITS) + (int) ((v >> shift) - (1u << HIST_SUB_BITS));
+    }
+
+    /* the middle of the range of values (in microseconds) that fall in bucket b */
+    static double valueOf(int b) {
+      if (b < (1 << HIST_SUB_BITS)) {
+        return b;
+      }
+      int shift = (b >> HIST_SUB_BITS) - 1;
+      uint64_t low = ((uint64_t) ((b & ((1 << HIST_SUB_BITS) - 1)) + (1 << HIST_SUB_BITS))) << shift;
+      return low + ((1ull << shift) - 1)/2.0;
+    }
+
+    /* to record a value, in ms */
+    void record(double ms) {
+      if (counts.empty()) {
+        counts.assign(bucketOf(HIST_MAX_VALUE) + 1, 0);
+      }
+      uint64_t v = (ms <= 0) ? 0 : (uint64_t) (ms*1000 + 0.5);
+      if (v > HIST_MAX_VALUE) {
+        v = HIST_MAX_VALUE;
+      }
+      counts[bucketOf(v)]++;
+      total++;
+      sum += ms;
+      if (ms > max) {
+        max = ms;
+      }
+    }
+
+    /* to add the values recorded in another histogram to this one */
+    void merge(const Histogram& o) {
+      if (o.total == 0) {
+        return;
+      }
+      if (counts.empty()) {
+        counts.assign(o.counts.size(), 0);
+      }
+      size_t b;
+      for (b = 0; b < counts.size(); b++) {
+        counts[b] += o.counts[b];
+      }
+      total += o.total;
+      sum += o.sum;
+      if (o.max > max) {
+        max = o.max;
+      }
+    }
+
+    /* the value (in ms) below which a fraction q of the recorded values fall */
+    double percentile(double q) const {
+      if (total == 0) {
+        return 0;
+      }
+      uint64_t rank = (uint64_t) ceil(q*total);
+      if (rank < 1) {
+        rank = 1;
+      }
+      uint64_t seen = 0;
+      size_t b;
+      for (b = 0; b < counts.size(); b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+          double v = valueOf(b)/1000;
+          return (v > max) ? max : v;
+        }
+      }
+      return max;
+    }
+
+    void snapshot(Snapshot& s) {
+      s.vec(counts);
+      s.raw(total);
+      s.raw(sum);
+      s.raw(max);
+    }
+};
+
+#define LAT_WAITING  0    /* the time a process spent waiting in the queues */
+#define LAT_RESPONSE 1    /* the time from a process's arrival until it was first picked to run */
+#define LAT_TAT      2    /* the turnaround time of a process */
+
+/* histograms of the waiting, response and turnaround times of the processes that have finished: for all of
+   them, for those that started in each level, and for those that were and weren't upgraded by aging; and,
+   for the processes with deadlines, in the same groups, how many missed them and by how much */
+class LatencyStats {
+  public:
+    int numLevels;                    /* the number of queue levels */
+    std::vector <Histogram> hist;     /* the histograms, numLevels + 3 for each of the LAT_* latencies */
+    std::vector <long> deadlines;     /* the number of processes with deadlines, in each group */
+    std::vector <long> misses;        /* the number of those that finished after their deadline */
+    std::vector <Histogram> lateness; /* how late (ms) those processes finished (0 if on time) */
+    std::vector <double> shareSum;    /* the sum of the shares of the CPU the processes got, in each group */
+    std::vector <double> shareSumSq;  /* the sum of their squares, for Jain's fairness index */
+
+    void init(int levels) {
+      numLevels = levels;
+      hist.assign(3*(levels + 3), Histogram());
+      deadlines.assign(levels + 3, 0);
+      misses.assign(levels + 3, 0);
+      lateness.assign(levels + 3, Histogram());
+      shareSum.assign(levels + 3, 0);
+      shareSumSq.assign(levels + 3, 0);
+    }
+
+    /* the histogram of latency lat for the group g: 0 for all the processes, 1 to numLevels for those
+       that started in that level, numLevels + 1 for those that were aged, and numLevels + 2 for the rest */
+    Histogram& of(int lat, int g) {
+      return hist[lat*(numLevels + 3) + g];
+    }
+
+    /* the number of processes whose latencies were recorded */
+    long count() const {
+      return hist[LAT_TAT*(numLevels + 3)].total;
+    }
+
+    /* to record the latencies of a process that started in level initLevel */
+    void record(int initLevel, int aged, double waiting, double response, double tat) {
+      double v[3] = {waiting, response, tat};
+      int lat;
+      for (lat = 0; lat < 3; lat++) {
+        of(lat, 0).record(v[lat]);
+        of(lat, initLevel).record(v[lat]);
+        of(lat, aged ? numLevels + 1 : numLevels + 2).record(v[lat]);
+      }
+    }
+
+    /* to record how a process that started in level initLevel finished relative to its deadline (late if
+       late > 0) */
+    void recordDeadline(int initLevel, int aged, double late) {
+      int groups[3] = {0, initLevel, aged ? numLevels + 1 : numLevels + 2};
+      int i;
+      for (i = 0; i < 3; i++) {
+        deadlines[groups[i]]++;
+        if (late > 0) {
+          misses[groups[i]]++;
+        }
+        lateness[groups[i]].record(late > 0 ? late : 0);
+      }
+    }
+
+    /* to record the share of the CPU a process that started in level initLevel got over its lifetime (its
+       CPU time over its turnaround time), divided by the share it is entitled to in that level (its weight,
+       in a CFS level, or its tickets, in a lottery or stride one) */
+    void recordShare(int initLevel, int aged, double share) {
+      int groups[3] = {0, initLevel, aged ? numLevels + 1 : numLevels + 2};
+      int i;
+      for (i = 0; i < 3; i++) {
+        shareSum[groups[i]] += share;
+        shareSumSq[groups[i]] += share*share;
+      }
+    }
+
+    /* Jain's fairness index of the shares recorded for the group g: 1 if every process got the same share
+       for its weight or tickets, down to 1/n if one process got it all */
+    double jain(int g) {
+      long n = of(LAT_TAT, g).total;
+      return (n > 0 && shareSumSq[g] > 0) ? (shareSum[g]*shareSum[g])/(n*shareSumSq[g]) : 1;
+    }
+
+    void merge(const LatencyStats& o) {
+      size_t i;
+      for (i = 0; i < hist.size(); i++) {
+        hist[i].merge(o.hist[i]);
+      }
+      for (i = 0; i < deadlines.size(); i++) {
+        deadlines[i] += o.deadlines[i];
+        misses[i] += o.misses[i];
+        lateness[i].merge(o.lateness[i]);
+        shareSum[i] += o.shareSum[i];
+        shareSumSq[i] += o.shareSumSq[i];
+      }
+    }
+
+    /* the name of the group g */
+    void groupName(int g, char* group, size_t size) {
+      if (g == 0) {
+        snprintf(group, size, "all");
+      }
+      else if (g <= numLevels) {
+        snprintf(group, size, "level %d", g);
+      }
+      else {
+        snprintf(group, size, (g == numLevels + 1) ? "aged" : "not aged");
+      }
+    }
+
+    /* to print the mean and the p50/p90/p99/p999 percentiles of each latency, for each group that has
+       any processes in it */
+    void report(FILE* out) {
+      const char* names[3] = {"Waiting", "Response", "Turnaround"};
+      int lat, g;
+      for (lat = 0; lat < 3; lat++) {
+        for (g = 0; g < numLevels + 3; g++) {
+          Histogram& h = of(lat, g);
+          if (h.total == 0) {
+            continue;
+          }
+          char group[24];
+          groupName(g, group, sizeof(group));
+          fprintf(out, "%-10s Time(ms): %-8s; Count: %-7llu; Mean: %-8.2lf; p50: %-8.2lf; p90: %-8.2lf; p99: %-8.2lf; p999: %-8.2lf; Max: %-8.2lf\n", names[lat], group, (unsigned long long) h.total, h.sum/h.total, h.percentile(0.5), h.percentile(0.9), h.percentile(0.99), h.percentile(0.999), h.max);
+        }
+      }
+      for (g = 0; g < numLevels + 3; g++) {
+        if (of(LAT_TAT, g).total == 0) {
+          continue;
+        }
+        char group[24];
+        groupName(g, group, sizeof(group));
+        fprintf(out, "Fairness: %-8s; Jain's Index: %.4lf\n", group, jain(g));
+      }
+      for (g = 0; g < numLevels + 3; g++) {
+        if (deadlines[g] == 0) {
+          continue;
+        }
+        Histogram& h = lateness[g];
+        char group[24];
+        groupName(g, group, sizeof(group));
+        fprintf(out, "Deadlines: %-8s; Count: %-7ld; Missed: %-7ld (%6.2lf%%); Lateness(ms): Mean: %-8.2lf; p50: %-8.2lf; p90: %-8.2lf; p99: %-8.2lf; Max: %-8.2lf\n", group, deadlines[g], misses[g], (100.0*misses[g])/deadlines[g], h.sum/h.total, h.percentile(0.5), h.percentile(0.9), h.percentile(0.99), h.max);
+      }
+    }
+
+    void snapshot(Snapshot& s) {
+      s.check(numLevels, "number of levels");
+      s.list(hist);
+      s.vec(deadlines);
+      s.vec(misses);
+      s.list(lateness);
+      s.vec(shareSum);
+      s.vec(shareSumSq);
+    }
+};
+
+/* a bounded lock-free multi-producer multi-consumer FIFO queue (after Dmitry Vyukov's design):
+   each cell carries a sequence number that tells producers and consumers whether it is free to write or
+   ready to read, so that a push or a pop is a single compare-and-swap on the tail or the head, retried
+   only when another thread got there first */
+template <class T>
+class MPMCQueue {
+  public:
+    class Cell {
+      public:
+        std::atomic <size_t> seq;
+        T value;
+    };
+
+    std::vector <Cell> cells;
+    size_t mask;
+    alignas(64) std::atomic <size_t> tail;    /* the position of the next push */
+    alignas(64) std::atomic <size_t> head;    /* the position of the next pop */
+
+    /* to set the queue up to hold up to capacity (a power of 2) values */
+    void init(size_t capacity) {
+      cells = std::vector <Cell> (capacity);
+      mask = capacity - 1;
+      size_t i;
+      for (i = 0; i < capacity; i++) {
+        cells[i].seq.store(i, std::memory_order_relaxed);
+      }
+      tail.store(0, std::memory_order_relaxed);
+      head.store(0, std::memory_order_relaxed);
+    }
+
+    /* to add a value at the tail; returns 0 if the queue is full; retries counts the lost races */
+    int push(const T& v, long& retries) {
+      size_t pos = tail.load(std::memory_order_relaxed);
+      while (1) {
+        Cell& c = cells[pos & mask];
+        size_t seq = c.seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+        if (diff == 0) {
+          if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            c.value = v;
+            c.seq.store(pos + 1, std::memory_order_release);
+            return 1;
+          }
+          retries++;
+        }
+        else if (diff < 0) {
+          return 0;
+        }
+        else {
+          pos = tail.load(std::memory_order_relaxed);
+          retries++;
+        }
+      }
+    }
+
+    /* to take the value at the head; returns 0 if the queue is empty; retries counts the lost races */
+    int pop(T& v, long& retries) {
+      size_t pos = head.load(std::memory_order_relaxed);
+      while (1) {
+        Cell& c = cells[pos & mask];
+        size_t seq = c.seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+        if (diff == 0) {
+          if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            v = c.value;
+            c.seq.store(pos + mask + 1, std::memory_order_release);
+            return 1;
+          }
+          retries++;
+        }
+        else if (diff < 0) {
+          return 0;
+        }
+        else {
+          pos = head.load(std::memory_order_relaxed);
+          retries++;
+        }
+      }
+    }
+};
+
+/* a process that has finished, as it is logged; the binary log is a LOG_MAGIC header followed by these
+   records, as laid out in memory (host byte order) */
+class CompletionRecord {
+  public:
+    int32_t id;                 /* the process ID */
+    uint16_t initQueueLevel;    /* the level of the first queue the process was assigned to */
+    uint16_t currQueueLevel;    /* the level of the queue the process finished in */
+    double finishTime;          /* the time (ms) at which the process finished, as it is to be printed */
+    double tat;                 /* the turnaround time of the process */
+};
+
+/* to print a completion record as a line of the text log */
+inline int formatCompletion(char* buf, const CompletionRecord& r) {
+  return sprintf(buf, "ID: %-5d; Orig. Level: %-5d; Final Level: %-5d; Comp. Time(ms): %-7.2lf; TAT(ms): %-7.2lf\n", r.id, r.initQueueLevel, r.currQueueLevel, r.finishTime, r.tat);
+}
+
+/* logs the processes that finish without holding up the scheduler: the scheduler (or each worker) only
+   puts a fixed-size record into a lock-free ring, and a background thread takes the records out in
+   batches and writes them, either as the text lines of the output logs file (also echoed to stdout) or
+   as a compact binary log */
+class CompletionLog {
+  public:
+    MPMCQueue <CompletionRecord> ring;    /* the records not yet written */
+    FILE* fp;                             /* the file the records are written to */
+    int binary;                           /* whether the records are written in the binary format */
+    std::thread writer;                   /* the background thread writing the records */
+    std::atomic <int> closing;            /* whether no more records will be logged */
+    std::atomic <long> stalls;            /* the number of times a record had to wait for room in the ring */
+    long retries;                         /* the number of ring operations retried because of another thread */
+
+    /* to start logging to the file out, in the binary format if bin is 1 */
+    void open(FILE* out, int bin) {
+      ring.init(LOG_RING_SIZE);
+      fp = out;
+      binary = bin;
+      closing.store(0);
+      stalls = 0;
+      retries = 0;
+      if (binary) {
+        fwrite(LOG_MAGIC, 1, strlen(LOG_MAGIC), fp);
+      }
+      writer = std::thread(&CompletionLog::drain, this);
+    }
+
+    /* to log a process that has finished; safe to call from several threads at once */
+    void log(const CompletionRecord& r) {
+      long tries = 0;
+      while (!ring.push(r, tries)) {
+        stalls++;
+        sched_yield();
+      }
+    }
+
+    /* the body of the background thread: writing out whatever records are in the ring, a batch at a time,
+       until the log is closed and the ring is empty */
+    void drain() {
+      std::vector <char> text(LOG_BATCH*160);
+      std::vector <CompletionRecord> batch(LOG_BATCH);
+      long tries = 0;
+      while (1) {
+        int n = 0;
+        while (n < LOG_BATCH && ring.pop(batch[n], tries)) {
+          n++;
+        }
+        if (n == 0) {
+          if (closing.load(std::memory_order_acquire)) {
+            /* one last look, for records logged just before the log was closed */
+            if (!ring.pop(batch[0], tries)) {
+              break;
+            }
+            n = 1;
+          }
+          else {
+            usleep(LOG_IDLE_US);
+            continue;
+          }
+        }
+        if (binary) {
+          fwrite(batch.data(), sizeof(CompletionRecord), n, fp);
+          continue;
+        }
+        size_t len = 0;
+        int i;
+        for (i = 0; i < n; i++) {
+          len += formatCompletion(text.data() + len, batch[i]);
+        }
+        fwrite(text.data(), 1, len, fp);
+        fwrite(text.data(), 1, len, stdout);
+      }
+      retries = tries;
+    }
+
+    /* to wait for every record logged so far to be written, and stop the background thread */
+    void close() {
+      closing.store(1, std::memory_order_release);
+      writer.join();
+      fflush(fp);
+      fflush(stdout);
+    }
+};
+
+/* to convert the binary log in the file in into the text lines of the output logs file out */
+inline void convertLog(FILE* in, FILE* out) {
+  char magic[16];
+  size_t m = strlen(LOG_MAGIC);
+  if (fread(magic, 1, m, in) != m || memcmp(magic, LOG_MAGIC, m) != 0) {
+    std::cout << "Expected a binary log, starting with " << LOG_MAGIC << "\n";
+    exit(0);
+  }
+  CompletionRecord r;
+  char line[160];
+  while (fread(&r, sizeof(r), 1, in) == 1) {
+    formatCompletion(line, r);
+    fputs(line, out);
+  }
+}
+
+/* a timeline of the scheduler's decisions, streamed to a file in the Chrome trace event (JSON) format, which
+   chrome://tracing and Perfetto can open: the slices that processes ran for, on one track per CPU, and the
+   number of processes waiting in each queue level, along with the processes that were requeued into it or
+   upgraded to it by aging, on one track per level; events are written as they happen, through a large
+   stdio buffer, so that nothing about the run is kept in memory */
+class TimelineWriter {
+  public:
+    FILE* fp;                         /* the file the timeline is written to */
+    char* buf;                        /* the stdio buffer of fp */
+    long events;                      /* the number of events written so far */
+    std::vector <long> levelQueued;   /* the number of processes waiting in each level, on all the CPUs */
+
+    /* to start the timeline in the file fn, naming the tracks of the numCpus CPUs, numLevels levels and
+       numDevices devices */
+    void open(const char* fn, int numCpus, int numLevels, int numDevices) {
+      fp = fopen(fn, "w");
+      if (fp == NULL) {
+        std::cout << "Could not open the timeline file " << fn << "\n";
+        exit(0);
+      }
+      buf = (char*) malloc(TIMELINE_BUFFER_SIZE);
+      setvbuf(fp, buf, _IOFBF, TIMELINE_BUFFER_SIZE);
+      events = 0;
+      levelQueued.assign(numLevels, 0);
+      fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fp);
+      meta(TL_PID_CPUS, -1, "process_name", "CPUs");
+      meta(TL_PID_LEVELS, -1, "process_name", "Queue levels");
+      if (numDevices > 0) {
+        meta(TL_PID_DEVICES, -1, "process_name", "Devices");
+      }
+      char name[32];
+      int i;
+      for (i = 0; i < numCpus; i++) {
+        snprintf(name, sizeof(name), "CPU %d", i);
+        meta(TL_PID_CPUS, i, "thread_name", name);
+      }
+      for (i = 0; i < numLevels; i++) {
+        snprintf(name, sizeof(name), "Level %d", i + 1);
+        meta(TL_PID_LEVELS, i + 1, "thread_name", name);
+      }
+      for (i = 0; i < numDevices; i++) {
+        snprintf(name, sizeof(name), "Device %d", i + 1);
+        meta(TL_PID_DEVICES, i + 1, "thread_name", name);
+      }
+    }
+
+    /* to start a new event, separating it from the previous one */
+    void begin() {
+      if (events++ > 0) {
+        fputs(",\n", fp);
+      }
+    }
+
+    /* to name the process pid (or its thread tid, if tid >= 0) */
+    void meta(int pid, int tid, const char* what, const char* name) {
+      begin();
+      fprintf(fp, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\",\"args\":{\"name\":\"%s\"}}", pid, tid < 0 ? 0 : tid, what, name);
+    }
+
+    /* to record that process id, from level (1-based), ran on CPU cpu from start for dur ms, and why it
+       stopped: "end" of its slice, "finish" of its burst, or "preempt" */
+    void slice(int cpu, int id, int level, double start, double dur, const char* why) {
+      begin();
+      fprintf(fp, "{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3lf,\"dur\":%.3lf,\"name\":\"P%d\",\"cat\":\"level %d\",\"args\":{\"stop\":\"%s\"}}", TL_PID_CPUS, cpu, start*1000, dur*1000, id, level, why);
+    }
+
+    /* to record that device (1-based) served an I/O request of process id from start for dur ms */
+    void io(int device, int id, double start, double dur) {
+      begin();
+      fprintf(fp, "{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3lf,\"dur\":%.3lf,\"name\":\"P%d\",\"cat\":\"io\"}", TL_PID_DEVICES, device, start*1000, dur*1000, id);
+    }
+
+    /* to record something that happened to process id at time t, on the track of CPU cpu (if level is 0)
+       or of level level */
+    void instant(int cpu, int level, double t, const char* what, int id) {
+      begin();
+      fprintf(fp, "{\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%.3lf,\"name\":\"%s P%d\"}", level > 0 ? TL_PID_LEVELS : TL_PID_CPUS, level > 0 ? level : cpu, t*1000, what, id);
+    }
+
+    /* to record that the number of processes waiting in level (1-based) changed by delta at time t */
+    void queued(int level, double t, int delta) {
+      levelQueued[level - 1] += delta;
+      begin();
+      fprintf(fp, "{\"ph\":\"C\",\"pid\":%d,\"ts\":%.3lf,\"name\":\"Level %d waiting\",\"args\":{\"processes\":%ld}}", TL_PID_LEVELS, t*1000, level, levelQueued[level - 1]);
+    }
+
+    /* to record that the time quantum of the first level became q ms at time t */
+    void quantum(double t, int q) {
+      begin();
+      fprintf(fp, "{\"ph\":\"C\",\"pid\":%d,\"ts\":%.3lf,\"name\":\"Level 1 quantum\",\"args\":{\"ms\":%d}}", TL_PID_LEVELS, t*1000, q);
+    }
+
+    void close() {
+      fputs("\n]}\n", fp);
+      fclose(fp);
+      free(buf);
+    }
+};
+
+/* the multi-level feedback queues of one group of processes on one CPU */
+class Mlfq {
+  public:
+    /* the queues, from the highest level (1) to the lowest */
+    std::vector <AnyLevel> levels;
+    unsigned nonEmpty;            /* bit i is set if level i+1 has processes waiting in it */
+
+    /* the aging index: a min heap of the processes waiting in these queues below the first, by the time at
+       which they joined their queue */
+    HandleHeap <AgingLess, &ProcessTable::agingPos> aging;
+
+    void snapshot(Snapshot& s) {
+      size_t l;
+      for (l = 0; l < levels.size(); l++) {
+        s.check(levels[l].index(), "level policies");
+        std::visit([&](auto& level) { level.snapshot(s); }, levels[l]);
+      }
+      s.raw(nonEmpty);
+      aging.snapshot(s);
+    }
+};
+
+/* a simulated CPU, with the multi-level feedback queues of each group of processes, which it shares out
+   between the groups in proportion to their shares: each group's virtual runtime is the CPU time it has
+   had on this CPU over its shares, and the CPU picks, from the top of the hierarchy down, the subgroup with
+   processes waiting that has the least virtual runtime */
+class Core {
+  public:
+    std::vector <Mlfq> groups;          /* the queues of each group (only those of groups without subgroups are used) */
+    std::vector <double> vruntime;      /* the virtual runtime of each group on this CPU */
+    std::vector <long> waiting;         /* the number of processes waiting in each group and its subgroups */
+    long queued;                  /* the number of processes waiting in this CPU's queues */
+
+    int busy;                     /* whether a process is currently running on this CPU */
+    Handle running;               /* the process currently running on this CPU */
+    double slice;                 /* the duration for which the running process was scheduled */
+    int runLevel;                 /* the index of the level the running process was picked from */
+    double runStart;              /* the time at which the running process started running, after the switch to it */
+    int lastId;                   /* the ID of the process that last ran on this CPU, whose working set is cached (-1 if none) */
+    long endSeq;                  /* the sequence number of the pending end of its slice (-1 if none) */
+    double agingAt;               /* the time at which the next process waiting on this CPU is due to be upgraded */
+    long agingSeq;                /* the sequence number of the pending event for it (-1 if none) */
+
+    double busyTime;              /* the total time this CPU spent running processes */
+    long dispatches;              /* the number of times a process was picked to run on this CPU */
+    long stolen;                  /* the number of processes this CPU took from the queues of other CPUs */
+    long preempted;               /* the number of times the process running on this CPU was preempted */
+    long switches;                /* the number of times this CPU switched to a different process */
+    double switchTime;            /* the time this CPU spent on context switches */
+    double refillTime;            /* the time this CPU spent refilling its cache */
+
+    void snapshot(Snapshot& s) {
+      s.check(groups.size(), "number of groups");
+      size_t g;
+      for (g = 0; g < groups.size(); g++) {
+        groups[g].snapshot(s);
+      }
+      s.vec(vruntime);
+      s.vec(waiting);
+      s.raw(queued);
+      s.raw(busy);
+      s.raw(running);
+      s.raw(slice);
+      s.raw(runLevel);
+      s.raw(runStart);
+      s.raw(lastId);
+      s.raw(endSeq);
+      s.raw(agingAt);
+      s.raw(agingSeq);
+      s.raw(busyTime);
+      s.raw(dispatches);
+      s.raw(stolen);
+      s.raw(preempted);
+      s.raw(switches);
+      s.raw(switchTime);
+      s.raw(refillTime);
+    }
+};
+
+/* the completions and the latencies of the processes of a group */
+class GroupStats {
+  public:
+    long completions;             /* the number of processes of the group that finished */
+    double sumTat;                /* the sum of their TATs */
+    double cpuTime;               /* the CPU time the group's processes had */
+    double contendedTime;         /* the part of it they had while other groups had processes waiting */
+    Histogram response;           /* the distribution of their response times */
+    Histogram tat;                /* the distribution of their TATs */
+
+    GroupStats() {
+      completions = 0;
+      sumTat = 0;
+      cpuTime = 0;
+      contendedTime = 0;
+    }
+
+    void snapshot(Snapshot& s) {
+      s.raw(completions);
+      s.raw(sumTat);
+      s.raw(cpuTime);
+      s.raw(contendedTime);
+      response.snapshot(s);
+      tat.snapshot(s);
+    }
+};
+
+/* how often processes were moved between CPUs, what it cost, and how the processes that were moved fared
+   against those that never were */
+class AffinityStats {
+  public:
+    long moves;                   /* the number of times a process ran on a different CPU from the last time */
+    long remoteMoves;             /* the number of those times that the CPU was on another node */
+    double moveTime;              /* the time the CPUs spent on those moves */
+    long finished[2];             /* the number of processes that finished, never moved (0) or moved (1) */
+    double sumTat[2];             /* the sum of their TATs */
+
+    AffinityStats() {
+      moves = 0;
+      remoteMoves = 0;
+      moveTime = 0;
+      finished[0] = finished[1] = 0;
+      sumTat[0] = sumTat[1] = 0;
+    }
+
+    void snapshot(Snapshot& s) {
+      s.raw(moves);
+      s.raw(remoteMoves);
+      s.raw(moveTime);
+      s.raw(finished);
+      s.raw(sumTat);
+    }
+};
+
+/* a simulated I/O device, which serves the I/O requests of blocked processes one at a time, in the order in
+   which they were made */
+class Device {
+  public:
+    double serviceTime;           /* the time it takes to serve a request that does not give its own */
+    HandleList queue;             /* the processes waiting for the device */
+    int busy;                     /* whether a request is being served */
+    Handle serving;               /* the process whose request is being served */
+    double serveStart;            /* the time at which that request started being served */
+
+    double busyTime;              /* the total time the device spent serving requests */
+    long requests;                /* the number of requests served */
+    double sumQueueDelay;         /* the total time requests spent waiting for the device */
+
+    void snapshot(Snapshot& s) {
+      queue.snapshot(s);
+      s.raw(busy);
+      s.raw(serving);
+      s.raw(serveStart);
+      s.raw(busyTime);
+      s.raw(requests);
+      s.raw(sumQueueDelay);
+    }
+};
+
+/* the multi-level feedback queue scheduler, driven by a queue of timed events: the arrival of processes
+   into their queues, the end of the time slice / CPU burst of the process running on a CPU, and the end of
+   the I/O request being served by a device, after which the process rejoins the queues; each CPU
+   always runs a process from its highest non-empty queue level, and a CPU whose queues are empty takes
+   the next process to run from the CPU with the most processes waiting */
+class Scheduler {
+  public:
+    ProcessTable procs;           /* the processes that have arrived and not yet finished */
+    std::vector <Core> cores;     /* the CPUs */
+    std::vector <Device> devices; /* the I/O devices */
+    std::vector <AnyLevel> levels;    /* the (empty) queue levels that each group's queues start as */
+    const GroupTree* tree;        /* the groups that processes are scheduled on behalf of */
+    double groupSlice;            /* the longest a process runs before the CPU is shared out again (0 for no limit) */
+    std::vector <GroupStats> groupStats;   /* the completions and latencies of each group */
+    int idleCores;                /* the number of CPUs with no process running on them */
+    long queued;                  /* the number of processes waiting in the queues of all the CPUs */
+    long promotions;              /* the number of times a process was upgraded to a higher queue */
+    long migrations;              /* the number of processes moved from one CPU's queues to another's */
+
+    long threshold;               /* the waiting time beyond which a process is upgraded to the next higher queue */
+    int preemptive;               /* whether a process joining a higher level preempts the running process */
+    long preemptions;             /* the number of times a running process was preempted */
+    CostModel cost;               /* the cost of switching a CPU from one process to another */
+    QuantumTuner tuner;           /* the controller of the first level's time quantum, if it is adaptive */
+    Topology topo;                /* the layout of the CPUs into nodes, and how processes are placed on them */
+    AffinityStats affinity;       /* how often processes moved between CPUs, and what it cost */
+    uint64_t seed;                /* the seed of the run, from which every lottery level's draws are seeded */
+
+    Clock clock;                  /* the clock that the scheduler runs against */
+    std::priority_queue <Event, std::vector<Event>, EventCompare> events;   /* the pending events */
+    long eventSeq;                /* the number of events queued so far */
+    ProcessSource* trace;         /* the input file, from which processes are read as they arrive */
+
+    CompletionLog* log;           /* the log of the processes that finish (NULL to not log them) */
+    TimelineWriter* timeline;     /* the timeline of scheduling decisions (NULL to not record one) */
+    int numProc;                  /* the total number of processes that need to be scheduled/run */
+    double sumTat;                /* the sum of TATs, to compute mean TAT at the end */
+    double makespan;              /* the time at which the last process finished */
+    long decisions;               /* the number of times a process was picked to run on a CPU */
+    LatencyStats latency;         /* the distributions of the waiting, response and turnaround times */
+
+    Scheduler(const std::vector<AnyLevel>& lv, int numCores, long thresh, int preempt, int sim, CompletionLog* out) {
+      cores.resize(numCores);
+      levels = lv;
+      seed = 1;
+      static const GroupTree flat;
+      setGroups(&flat, 0);
+      int c;
+      for (c = 0; c < numCores; c++) {
+        cores[c].queued = 0;
+        cores[c].busy = 0;
+        cores[c].running = NIL_HANDLE;
+        cores[c].slice = 0;
+        cores[c].runLevel = 0;
+        cores[c].runStart = 0;
+        cores[c].lastId = -1;
+        cores[c].switches = 0;
+        cores[c].switchTime = 0;
+        cores[c].refillTime = 0;
+        cores[c].endSeq = -1;
+        cores[c].agingAt = INFINITY;
+        cores[c].agingSeq = -1;
+        cores[c].busyTime = 0;
+        cores[c].dispatches = 0;
+        cores[c].stolen = 0;
+        cores[c].preempted = 0;
+      }
+      idleCores = numCores;
+      latency.init(lv.size());
+      queued = 0;
+      promotions = 0;
+      migrations = 0;
+      threshold = thresh;
+      preemptive = preempt;
+      preemptions = 0;
+      clock.simulated = sim;
+      clock.begin();
+      eventSeq = 0;
+      trace = NULL;
+      log = out;
+      timeline = NULL;
+      numProc = 0;
+      sumTat = 0.0;
+      makespan = 0.0;
+      decisions = 0;
+    }
+
+    /* to schedule processes on behalf of the groups in t, sharing out each CPU between them at least every
+       slice ms (0 for only when the running process gives up the CPU) */
+    void setGroups(const GroupTree* t, double slice) {
+      tree = t;
+      groupSlice = slice;
+      Mlfq empty;
+      empty.levels = levels;
+      empty.nonEmpty = 0;
+      size_t c;
+      for (c = 0; c < cores.size(); c++) {
+        cores[c].groups.assign(t->size(), empty);
+        cores[c].vruntime.assign(t->size(), 0);
+        cores[c].waiting.assign(t->size(), 0);
+      }
+      groupStats.assign(t->size(), GroupStats());
+      seedLotteries();
+    }
+
+    /* to seed the lottery levels of every group on every CPU from the seed of the run, each with a seed
+       of its own, so that their draws are independent of each other */
+    void seedLotteries() {
+      Rng seeds;
+      seeds.seed(seed);
+      size_t c, g, l;
+      for (c = 0; c < cores.size(); c++) {
+        for (g = 0; g < cores[c].groups.size(); g++) {
+          for (l = 0; l < levels.size(); l++) {
+            uint64_t x = seeds.next();
+            Level<LotteryPolicy>* lottery = std::get_if <Level<LotteryPolicy>> (&cores[c].groups[g].levels[l]);
+            if (lottery != NULL) {
+              lottery->q.reseed(x);
+            }
+          }
+        }
+      }
+    }
+
+    /* to make x the seed of the run */
+    void setSeed(uint64_t x) {
+      seed = x;
+      seedLotteries();
+    }
+
+    /* to make q the time quantum of the first level, in the queues of every group on every CPU */
+    void setQuantum(int q) {
+      std::visit([&](auto& level) { level.quantum = q; }, levels[0]);
+      size_t c, g;
+      for (c = 0; c < cores.size(); c++) {
+        for (g = 0; g < cores[c].groups.size(); g++) {
+          std::visit([&](auto& level) { level.quantum = q; }, cores[c].groups[g].levels[0]);
+        }
+      }
+      if (timeline != NULL) {
+        timeline->quantum(clock.now, q);
+      }
+    }
+
+    /* the time quantum of the first level */
+    int firstQuantum() const {
+      return std::visit([](const auto& level) { return level.quantum; }, levels[0]);
+    }
+
+    /* to add a device for every one of the given service times */
+    void addDevices(const std::vector<long>& serviceTimes) {
+      devices.resize(serviceTimes.size());
+      size_t d;
+      for (d = 0; d < devices.size(); d++) {
+        devices[d].serviceTime = serviceTimes[d];
+        devices[d].busy = 0;
+        devices[d].serving = NIL_HANDLE;
+        devices[d].serveStart = 0;
+        devices[d].busyTime = 0;
+        devices[d].requests = 0;
+        devices[d].sumQueueDelay = 0;
+      }
+    }
+
+    /* to queue an event of the given type at time t, for CPU (or device) cpu */
+    void addEvent(double t, int type, int cpu, const Process& p) {
+      Event e;
+      e.time = t;
+      e.type = type;
+      e.cpu = cpu;
+      e.seq = eventSeq++;
+      e.p = p;
+      events.push(e);
+    }
+
+    /* to add a process to the queue of its group on CPU c corresponding to its current level, and, below
+       the first level, to the group's aging index; a group that had nothing waiting on the CPU restarts
+       from the least virtual runtime of its siblings with processes waiting, so that it can't make up for
+       the time it had nothing to run; a process that was taken off the CPU before it was done goes back
+       ahead of the processes that joined the level after it (if back is 1) */
+    void enqueue(int c, Handle h, int back = 0) {
+      Core& core = cores[c];
+      int g = procs.group[h];
+      Mlfq& q = core.groups[g];
+      int l = procs.currQueueLevel[h] - 1;
+      std::visit([&](auto& level) {
+        if (back) {
+          level.pushBack(procs, h);
+        }
+        else {
+          level.push(procs, h);
+        }
+      }, q.levels[l]);
+      q.nonEmpty |= 1u << l;
+      core.queued++;
+      queued++;
+      if (l > 0) {
+        q.aging.push(procs, h);
+        armAging(c);
+      }
+      int n;
+      for (n = g; n != ROOT_GROUP; n = tree->parent[n]) {
+        if (core.waiting[n]++ == 0) {
+          double floor = INFINITY;
+          for (int k : tree->children[tree->parent[n]]) {
+            if (k != n && core.waiting[k] > 0 && core.vruntime[k] < floor) {
+              floor = core.vruntime[k];
+            }
+          }
+          if (floor != INFINITY && core.vruntime[n] < floor) {
+            core.vruntime[n] = floor;
+          }
+        }
+      }
+      if (timeline != NULL) {
+        timeline->queued(l + 1, clock.now, 1);
+      }
+      /* a process of another group joining the queues cuts the running process's slice down to the group
+         slice, so that the CPU is shared out again */
+      if (groupSlice > 0 && core.busy && procs.group[core.running] != g) {
+        capSlice(c);
+      }
+    }
+
+    /* to take the process h out of its group's queue at index l (level l+1) on CPU c, and out of its aging
+       index */
+    void unlink(int c, Handle h, int l) {
+      Core& core = cores[c];
+      int g = procs.group[h];
+      Mlfq& q = core.groups[g];
+      std::visit([&](auto& level) {
+        level.remove(procs, h);
+        if (level.empty()) {
+          q.nonEmpty &= ~(1u << l);
+        }
+      }, q.levels[l]);
+      if (l > 0) {
+        q.aging.remove(procs, h);
+        armAging(c);
+      }
+      int n;
+      for (n = g; n != ROOT_GROUP; n = tree->parent[n]) {
+        core.waiting[n]--;
+      }
+      core.queued--;
+      queued--;
+      if (timeline != NULL) {
+        timeline->queued(l + 1, clock.now, -1);
+      }
+    }
+
+    /* the group (without subgroups) whose processes CPU c runs next: from the top of the hierarchy down,
+       the subgroup with processes waiting on the CPU that has the least virtual runtime */
+    int pickGroup(int c) {
+      Core& core = cores[c];
+      int g = ROOT_GROUP;
+      while (!tree->leaf(g)) {
+        int best = -1;
+        for (int k : tree->children[g]) {
+          if (core.waiting[k] > 0 && (best < 0 || core.vruntime[k] < core.vruntime[best])) {
+            best = k;
+          }
+        }
+        g = best;
+      }
+      return g;
+    }
+
+    /* to take the process at the head of the highest non-empty queue of the next group of CPU c out of it */
+    Handle dequeue(int c) {
+      Mlfq& q = cores[c].groups[pickGroup(c)];
+      int l = __builtin_ctz(q.nonEmpty);
+      Handle h = std::visit([&](auto& level) { return level.q.top(); }, q.levels[l]);
+      unlink(c, h, l);
+      return h;
+    }
+
+    /* whether a group other than g has processes waiting on CPU c */
+    int contended(int c, int g) const {
+      return cores[c].queued > cores[c].waiting[g];
+    }
+
+    /* to cut the slice of the process running on CPU c down to the group slice, now that a process of
+       another group is waiting for the CPU (or to end it now, if it has run for longer than that) */
+    void capSlice(int c) {
+      Core& core = cores[c];
+      double ran = clock.read() - core.runStart;
+      double end = (ran > groupSlice) ? ran : groupSlice;
+      if (core.slice <= end) {
+        return;
+      }
+      core.busyTime -= core.slice - end;
+      core.slice = end;
+      Process none;
+      core.endSeq = eventSeq;
+      addEvent(core.runStart + end, EV_BURST_END, c, none);
+    }
+
+    /* to charge the group g, and the groups above it, on CPU c for ran ms of CPU time, counting it towards
+       the group's share of the CPU while other groups compete for it */
+    void chargeGroup(int c, int g, double ran) {
+      Core& core = cores[c];
+      groupStats[g].cpuTime += ran;
+      if (contended(c, g)) {
+        groupStats[g].contendedTime += ran;
+      }
+      int n;
+      for (n = g; n != ROOT_GROUP; n = tree->parent[n]) {
+        core.vruntime[n] += ran/tree->shares[n];
+      }
+    }
+
+    /* to pick the CPU an arriving process is queued on: the one with the fewest processes running on it
+       or waiting in its queues */
+    int placeArrival() {
+      int best = 0;
+      int c;
+      for (c = 1; c < (int) cores.size(); c++) {
+        if (load(c) < load(best)) {
+          best = c;
+        }
+      }
+      return best;
+    }
+
+    /* the number of processes running on or waiting in the queues of CPU c */
+    long load(int c) const { return cores[c].queued + cores[c].busy; }
+
+    /* the node that CPU c is on */
+    int nodeOf(int c) const { return (c*topo.nodes)/(int) cores.size(); }
+
+    /* to pick the CPU that the process h, coming back from I/O, is queued on: without affinity, as for an
+       arriving process; with strict placement, the CPU it last ran on; and with soft and local placement,
+       that CPU unless it has more than the slack more processes than the least loaded CPU, in which case
+       local placement tries the least loaded CPU of the same node before going to another node */
+    int placeReturn(Handle h) {
+      int last = procs.lastCpu[h];
+      if (!topo.on || last < 0) {
+        return placeArrival();
+      }
+      if (topo.policy == PLACE_STRICT) {
+        return last;
+      }
+      int best = placeArrival();
+      if (load(last) <= load(best) + topo.slack) {
+        return last;
+      }
+      if (topo.policy == PLACE_LOCAL) {
+        int local = last;
+        int c;
+        for (c = 0; c < (int) cores.size(); c++) {
+          if (nodeOf(c) == nodeOf(last) && load(c) < load(local)) {
+            local = c;
+          }
+        }
+        if (load(local) <= load(best) + topo.slack) {
+          return local;
+        }
+      }
+      return best;
+    }
+
+    /* to start reading the processes from the input file; only the next process to arrive is kept
+       in the event queue, and the one after it is read when it arrives */
+    void addProcessesToQueue(ProcessSource* tr) {
+      trace = tr;
+      admitNext();
+    }
+
+    /* to queue the arrival of the process p at its arrival time, which must not be before the current time;
+       it is checked as a process read from the input file is, since its fields index the queues */
+    void submit(const Process& p) {
+      int numLevels = levels.size();
+      if (p.initQueueLevel < 1 || p.initQueueLevel > numLevels || p.currQueueLevel < 1 || p.currQueueLevel > numLevels) {
+        std::cout << "Expected the levels of process " << p.id << " to be in the range 1 - " << numLevels << "\n";
+        exit(0);
+      }
+      if (p.group <= ROOT_GROUP || p.group >= tree->size() || !tree->leaf(p.group)) {
+        std::cout << "Expected the group of process " << p.id << " to be one without subgroups, but received " << p.group << "\n";
+        exit(0);
+      }
+      if (p.weight <= 0 || p.tickets < 1) {
+        std::cout << "Expected process " << p.id << " to have a positive weight and number of tickets\n";
+        exit(0);
+      }
+      size_t i;
+      for (i = 0; i < p.phases.size(); i++) {
+        if (p.phases[i].device < 1 || p.phases[i].device > (int) devices.size()) {
+          std::cout << "Expected the devices of process " << p.id << " to be in the range 1 - " << devices.size() << "\n";
+          exit(0);
+        }
+      }
+      if (p.arrivalTime < clock.now) {
+        std::cout << "Expected process " << p.id << " to arrive no earlier than the current time " << clock.now << ", but it arrives at " << p.arrivalTime << "\n";
+        exit(0);
+      }
+      addEvent(p.arrivalTime, EV_ARRIVAL, -1, p);
+    }
+
+    /* to read the next process from the input file, and queue its arrival */
+    void admitNext() {
+      Process p;
+      if (trace != NULL && trace->next(p)) {
+        addEvent(p.arrivalTime, EV_ARRIVAL, -1, p);
+      }
+    }
+
+    /* to upgrade every process that has been waiting in a queue of CPU c below the first for more than
+       the threshold time, since its arrival into that queue, to the immediate higher queue (of its group);
+       when the check is made because a process is due (due is 1), that process has waited for exactly the
+       threshold time, and is upgraded too; in preemptive mode, an upgraded process may preempt the running
+       one */
+    void checkThreshold(int c, int due = 0) {
+      Core& core = cores[c];
+      double tempT = clock.now;
+      size_t g;
+      for (g = 0; g < core.groups.size(); g++) {
+        Mlfq& q = core.groups[g];
+        while (!q.aging.empty() && (tempT - procs.currArrivalTime[q.aging.top()] > threshold ||
+                                    (due && tempT >= procs.currArrivalTime[q.aging.top()] + threshold))) {
+          Handle h = q.aging.top();
+          unlink(c, h, procs.currQueueLevel[h] - 1);
+          procs.currArrivalTime[h] = tempT;
+          procs.currQueueLevel[h]--;
+          procs.aged[h] = 1;
+          enqueue(c, h);
+          promotions++;
+          if (timeline != NULL) {
+            timeline->instant(c, procs.currQueueLevel[h], tempT, "promote", procs.id[h]);
+          }
+          if (shouldPreempt(c, h)) {
+            preempt(c);
+          }
+        }
+      }
+    }
+
+    /* in preemptive mode, to make sure that the next process waiting on CPU c to be due to be upgraded is
+       upgraded when it is due, rather than when a burst next ends, so that it can preempt a long burst of a
+       lower level; there is at most one pending event for it on each CPU, at the time the next process is
+       due, and the earlier ones are ignored */
+    void armAging(int c) {
+      if (!preemptive) {
+        return;
+      }
+      Core& core = cores[c];
+      double at = INFINITY;
+      size_t g;
+      for (g = 0; g < core.groups.size(); g++) {
+        Mlfq& q = core.groups[g];
+        if (!q.aging.empty() && procs.currArrivalTime[q.aging.top()] + threshold < at) {
+          at = procs.currArrivalTime[q.aging.top()] + threshold;
+        }
+      }
+      /* a process put back after being preempted may already be due */
+      if (at < clock.now) {
+        at = clock.now;
+      }
+      if (at == core.agingAt) {
+        return;
+      }
+      core.agingAt = at;
+      core.agingSeq = -1;
+      if (at != INFINITY) {
+        Process none;
+        core.agingSeq = eventSeq;
+        addEvent(at, EV_AGING, c, none);
+      }
+    }
+
+    /* to move the process at the head of the highest non-empty queue of the CPU with the most processes
+       waiting onto the same level of CPU c; returns 0 if no CPU has processes waiting; with strict placement
+       nothing is stolen, and with local placement CPUs on the same node are stolen from first, and those on
+       other nodes only if they have more than the slack waiting */
+    int steal(int c) {
+      if (topo.on && topo.policy == PLACE_STRICT) {
+        return 0;
+      }
+      int local = topo.on && topo.policy == PLACE_LOCAL;
+      int victim = -1;
+      int v;
+      for (v = 0; v < (int) cores.size(); v++) {
+        if (v == c || cores[v].queued == 0) {
+          continue;
+        }
+        int near = nodeOf(v) == nodeOf(c);
+        if (local && !near && cores[v].queued <= topo.slack) {
+          continue;
+        }
+        if (victim < 0) {
+          victim = v;
+        }
+        else if (local && near != (nodeOf(victim) == nodeOf(c))) {
+          victim = near ? v : victim;
+        }
+        else if (cores[v].queued > cores[victim].queued) {
+          victim = v;
+        }
+      }
+      if (victim < 0) {
+        return 0;
+      }
+      Handle h = dequeue(victim);
+      enqueue(c, h);
+      cores[c].stolen++;
+      migrations++;
+      if (timeline != NULL) {
+        timeline->instant(c, 0, clock.now, "steal", procs.id[h]);
+      }
+      return 1;
+    }
+
+    /* to schedule the next process from the highest non-empty queue of the next group of CPU c on it, for
+       a time quantum if its level is time-sliced and it has more than a time quantum of its burst left, or
+       else for the rest of its burst (but, with groups, for no longer than the group slice while another
+       group has processes waiting on the CPU); switching to a
+       process other than the one that last ran on the CPU first costs a context switch and the refill of
+       the cache with its working set */
+    void dispatch(int c) {
+      Core& core = cores[c];
+      if (core.queued == 0 && !steal(c)) {
+        return;
+      }
+      Handle h = dequeue(c);
+      int l = procs.currQueueLevel[h] - 1;
+      core.slice = std::visit([&](auto& level) { return level.sliceFor(procs, h); }, core.groups[procs.group[h]].levels[l]);
+      if (groupSlice > 0 && core.slice > groupSlice && contended(c, procs.group[h])) {
+        core.slice = groupSlice;
+      }
+      double overhead = 0;
+      if (procs.id[h] != core.lastId) {
+        double refill = cost.refill(procs.workingSet[h]);
+        overhead = cost.switchCost + refill;
+        core.switches++;
+        core.switchTime += cost.switchCost;
+        core.refillTime += refill;
+        core.lastId = procs.id[h];
+      }
+      /* with affinity, running a process on a CPU other than the one it last ran on costs the move, which
+         is dearer across nodes */
+      int moved = 0;
+      if (topo.on) {
+        int last = procs.lastCpu[h];
+        if (last >= 0 && last != c) {
+          int remote = nodeOf(last) != nodeOf(c);
+          double m = remote ? topo.remoteCost : topo.migrateCost;
+          overhead += m;
+          affinity.moves++;
+          affinity.remoteMoves += remote;
+          affinity.moveTime += m;
+          procs.migrated[h] = 1;
+          moved = 1;
+        }
+        procs.lastCpu[h] = c;
+      }
+      if (timeline != NULL && overhead > 0) {
+        timeline->slice(c, procs.id[h], l + 1, clock.read(), overhead, moved ? "migrate" : "switch");
+      }
+      core.running = h;
+      core.runLevel = l;
+      core.runStart = clock.read() + overhead;
+      if (procs.firstRunTime[h] < 0) {
+        procs.firstRunTime[h] = core.runStart;
+      }
+      core.busy = 1;
+      core.busyTime += overhead + core.slice;
+      core.dispatches++;
+      idleCores--;
+      decisions++;
+      /* the process "runs on the CPU" until the end of its slice, unless it is preempted before then */
+      Process none;
+      core.endSeq = eventSeq;
+      addEvent(core.runStart + core.slice, EV_BURST_END, c, none);
+    }
+
+    /* whether the process h, which has just joined a queue of CPU c, should take the CPU from the process
+       running on it: in preemptive mode, if it is in a higher level, and within a level that runs the
+       process with the least burst left first, if it has less burst left; a process of another group
+       waits for the group slice to end instead */
+    int shouldPreempt(int c, Handle h) {
+      Core& core = cores[c];
+      if (!core.busy || procs.group[h] != procs.group[core.running]) {
+        return 0;
+      }
+      int l = procs.currQueueLevel[h] - 1;
+      if (l < core.runLevel) {
+        return preemptive;
+      }
+      if (l > core.runLevel) {
+        return 0;
+      }
+      double ran = clock.read() - core.runStart;
+      if (ran < 0) {
+        ran = 0;
+      }
+      return std::visit([&](auto& level) { return level.preempts(procs, h, core.running, ran, preemptive); }, core.groups[procs.group[h]].levels[l]);
+    }
+
+    /* to take CPU c from the process running on it, charging it for the part of its slice it has run, and
+       put it back in its queue where it was; the pending end of its slice is then ignored */
+    void preempt(int c) {
+      Core& core = cores[c];
+      Handle h = core.running;
+      double ran = clock.read() - core.runStart;
+      /* a process about to finish its slice, or still being switched to, is left to run */
+      if (ran >= core.slice || ran < 0) {
+        return;
+      }
+      if (timeline != NULL) {
+        timeline->slice(c, procs.id[h], core.runLevel + 1, core.runStart, ran, "preempt");
+        timeline->instant(c, 0, core.runStart + ran, "preempt", procs.id[h]);
+      }
+      procs.burstTime[h] -= ran;
+      procs.vruntime[h] += ran/procs.weight[h];
+      procs.pass[h] += ran*STRIDE1/procs.tickets[h];
+      chargeGroup(c, procs.group[h], ran);
+      core.busyTime -= core.slice - ran;
+      core.busy = 0;
+      core.running = NIL_HANDLE;
+      core.endSeq = -1;
+      core.preempted++;
+      idleCores++;
+      preemptions++;
+      /* the process keeps the time it joined its queue, so that it neither loses its place among the
+         processes that joined after it nor restarts its aging */
+      enqueue(c, h, 1);
+    }
+
+    /* whether an event is the end of a slice whose process has since been preempted, or a process being
+       due to be upgraded that no longer is the next to be */
+    int stale(const Event& e) {
+      return (e.type == EV_BURST_END && e.seq != cores[e.cpu].endSeq) || (e.type == EV_AGING && e.seq != cores[e.cpu].agingSeq);
+    }
+
+    /* to log a process that has finished its CPU burst */
+    void finish(Handle h) {
+      double finishTime = clock.now;
+      double tat = finishTime - procs.arrivalTime[h];
+      if (log != NULL) {
+        CompletionRecord r;
+        r.id = procs.id[h];
+        r.initQueueLevel = procs.initQueueLevel[h];
+        r.currQueueLevel = procs.currQueueLevel[h];
+        r.finishTime = clock.start + finishTime;
+        r.tat = tat;
+        log->log(r);
+      }
+      sumTat += tat;
+      makespan = finishTime;
+      latency.record(procs.initQueueLevel[h], procs.aged[h], tat - procs.serviceTime[h] - procs.blockedTime[h], procs.firstRunTime[h] - procs.arrivalTime[h], tat);
+      GroupStats& gs = groupStats[procs.group[h]];
+      gs.completions++;
+      gs.sumTat += tat;
+      gs.response.record(procs.firstRunTime[h] - procs.arrivalTime[h]);
+      gs.tat.record(tat);
+      double entitled = std::visit([&](auto& level) { return level.entitlement(procs, h); }, levels[procs.initQueueLevel[h] - 1]);
+      latency.recordShare(procs.initQueueLevel[h], procs.aged[h], (tat > 0) ? procs.serviceTime[h]/(tat*entitled) : 1/entitled);
+      if (procs.deadline[h] != INFINITY) {
+        latency.recordDeadline(procs.initQueueLevel[h], procs.aged[h], finishTime - procs.deadline[h]);
+      }
+      affinity.finished[procs.migrated[h]]++;
+      affinity.sumTat[procs.migrated[h]] += tat;
+      procs.release(h);
+    }
+
+    /* to park the process h, which has finished a CPU burst, on the queue of the device its next I/O
+       request goes to */
+    void block(Handle h) {
+      int d = procs.phases[h][procs.phase[h]].device - 1;
+      procs.currArrivalTime[h] = clock.now;
+      devices[d].queue.push(procs, h);
+      if (!devices[d].busy) {
+        startIo(d);
+      }
+    }
+
+    /* to start serving the request of the process at the head of the queue of device d */
+    void startIo(int d) {
+      Device& dev = devices[d];
+      Handle h = dev.queue.pop(procs);
+      const BurstPhase& ph = procs.phases[h][procs.phase[h]];
+      double t = (ph.ioTime >= 0) ? ph.ioTime : dev.serviceTime;
+      dev.busy = 1;
+      dev.serving = h;
+      dev.serveStart = clock.now;
+      dev.busyTime += t;
+      dev.requests++;
+      dev.sumQueueDelay += clock.now - procs.currArrivalTime[h];
+      Process none;
+      addEvent(clock.now + t, EV_IO_END, d, none);
+    }
+
+    /* to handle an event that has occurred */
+    void handleEvent(Event& e) {
+      switch (e.type) {
+        case EV_ARRIVAL: {
+              e.p.currArrivalTime = e.p.arrivalTime;
+              int c = placeArrival();
+              Handle h = procs.add(e.p);
+              enqueue(c, h);
+              if (shouldPreempt(c, h)) {
+                preempt(c);
+              }
+              numProc++;
+              /* the next process in the input file can only arrive at or after this one */
+              admitNext();
+              break;
+        }
+
+        case EV_BURST_END: {
+              Core& core = cores[e.cpu];
+              Handle h = core.running;
+              core.busy = 0;
+              core.running = NIL_HANDLE;
+              core.endSeq = -1;
+              idleCores++;
+              procs.burstTime[h] -= core.slice;
+              procs.vruntime[h] += core.slice/procs.weight[h];
+              procs.pass[h] += core.slice*STRIDE1/procs.tickets[h];
+              chargeGroup(e.cpu, procs.group[h], core.slice);
+              if (timeline != NULL) {
+                timeline->slice(e.cpu, procs.id[h], core.runLevel + 1, core.runStart, core.slice, procs.burstTime[h] > 0 ? "end" : "finish");
+              }
+              /* a process that has not finished its burst is pushed back onto the tail of its
+                 (Round Robin) queue, with modified leftover burst time; one from a level that runs
+                 processes to the end of their bursts was only stopped to share the CPU out between
+                 the groups, so it goes back where it was */
+              if (procs.burstTime[h] > 0) {
+                if (std::visit([](auto& level) { return level.timeSliced(); }, core.groups[procs.group[h]].levels[core.runLevel])) {
+                  procs.currArrivalTime[h] = clock.now;
+                  enqueue(e.cpu, h);
+                }
+                else {
+                  enqueue(e.cpu, h, 1);
+                }
+                if (timeline != NULL) {
+                  timeline->instant(e.cpu, procs.currQueueLevel[h], clock.now, "requeue", procs.id[h]);
+                }
+              }
+              else {
+                /* with an adaptive quantum, the length of each burst that finishes is taken note of,
+                   and may retune the quantum */
+                if (tuner.on) {
+                  int q = firstQuantum();
+                  int next = tuner.observe(procs.burstLength[h], clock.now, q);
+                  if (next != q) {
+                    setQuantum(next);
+                  }
+                }
+                /* a process that has finished a CPU burst and has an I/O request to make next blocks on it */
+                if (procs.phase[h] < procs.phases[h].size()) {
+                  block(h);
+                }
+                else {
+                  finish(h);
+                }
+              }
+              /* each time a process finishes its CPU burst, the scheduler checks if any processes
+                 have been waiting for too long */
+              checkThreshold(e.cpu);
+              break;
+        }
+
+        case EV_AGING: {
+              Core& core = cores[e.cpu];
+              core.agingAt = INFINITY;
+              core.agingSeq = -1;
+              checkThreshold(e.cpu, 1);
+              armAging(e.cpu);
+              break;
+        }
+
+        case EV_IO_END: {
+              Device& dev = devices[e.cpu];
+              Handle h = dev.serving;
+              dev.busy = 0;
+              dev.serving = NIL_HANDLE;
+              if (timeline != NULL) {
+                timeline->io(e.cpu + 1, procs.id[h], dev.serveStart, clock.now - dev.serveStart);
+              }
+              procs.blockedTime[h] += clock.now - procs.currArrivalTime[h];
+              const BurstPhase& ph = procs.phases[h][procs.phase[h]++];
+              /* the process rejoins the queues, at the level it left them from, for its next CPU burst */
+              if (ph.cpuTime > 0) {
+                procs.burstTime[h] = ph.cpuTime;
+                procs.burstLength[h] = ph.cpuTime;
+                procs.currArrivalTime[h] = clock.now;
+                int c = placeReturn(h);
+                enqueue(c, h);
+                if (shouldPreempt(c, h)) {
+                  preempt(c);
+                }
+              }
+              else {
+                finish(h);
+              }
+              if (!dev.queue.empty()) {
+                startIo(e.cpu);
+              }
+              break;
+        }
+      }
+    }
+
+    /* to take one step: scheduling the next process on every free CPU while processes are waiting, and
+       then, if the next event occurs no later than until, moving the clock to it and handling it along
+       with every other event that has occurred by then; returns 0 (having taken no step) if there are no
+       events left by until */
+    int step(double until) {
+      /* whenever a CPU is free and processes are waiting, the next process is scheduled on it */
+      int c;
+      for (c = 0; c < (int) cores.size() && idleCores > 0 && queued > 0; c++) {
+        if (!cores[c].busy) {
+          dispatch(c);
+        }
+      }
+      while (!events.empty() && stale(events.top())) {
+        events.pop();
+      }
+      if (events.empty() || events.top().time > until) {
+        return 0;
+      }
+      Event e = events.top();
+      events.pop();
+      double now = clock.advanceTo(e.time);
+      handleEvent(e);
+      while (!events.empty() && events.top().time <= now) {
+        e = events.top();
+        events.pop();
+        if (!stale(e)) {
+          handleEvent(e);
+        }
+      }
+      return 1;
+    }
+
+    /* to run the scheduler up to time t, handling every event that occurs by then, and leave the clock
+       at t, so that processes can be submitted from there on */
+    void runUntil(double t) {
+      while (step(t)) {
+      }
+      clock.advanceTo(t);
+    }
+
+    /* to run the scheduler until there are no processes left to be scheduled/run */
+    void run() {
+      while (step(INFINITY)) {
+      }
+      if (!clock.simulated) {
+        makespan = clock.read();
+      }
+    }
+
+    /* to save or load the whole state of the scheduler, along with how far through its processes the input
+       file (or generator) is; the settings it was made with aren't part of it, so that a snapshot can be
+       picked up by a scheduler with, say, a different threshold, to see what would happen from there on */
+    void snapshot(Snapshot& s) {
+      char magic[8];
+      memcpy(magic, SNAPSHOT_MAGIC, sizeof(magic));
+      s.raw(magic);
+      if (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0) {
+        std::cout << "Expected a scheduler snapshot, but the file does not start with " << SNAPSHOT_MAGIC << "\n";
+        exit(0);
+      }
+      s.check(cores.size(), "number of CPUs");
+      s.check(devices.size(), "number of devices");
+      s.check(levels.size(), "number of levels");
+      size_t l;
+      for (l = 0; l < levels.size(); l++) {
+        s.check(levels[l].index(), "level policies");
+        std::visit([&](auto& level) { level.snapshot(s); }, levels[l]);
+      }
+      procs.snapshot(s);
+      s.list(cores);
+      s.list(devices);
+      s.raw(idleCores);
+      s.raw(queued);
+      s.raw(promotions);
+      s.raw(migrations);
+      s.raw(preemptions);
+      s.raw(clock.now);
+      s.raw(eventSeq);
+      s.raw(numProc);
+      s.raw(sumTat);
+      s.raw(makespan);
+      s.raw(decisions);
+      latency.snapshot(s);
+      s.list(groupStats);
+      tuner.snapshot(s);
+      /* an adaptive first quantum is state rather than a setting, so it is picked up where it was */
+      if (tuner.on) {
+        int q = firstQuantum();
+        s.raw(q);
+        if (s.loading) {
+          setQuantum(q);
+        }
+      }
+      affinity.snapshot(s);
+
+      /* the pending events, in the order they occur in; being ordered by sequence number as well as time,
+         they come back out of the queue in that same order */
+      uint64_t n = events.size();
+      s.raw(n);
+      if (s.loading) {
+        events = std::priority_queue <Event, std::vector<Event>, EventCompare>();
+        uint64_t i;
+        for (i = 0; i < n; i++) {
+          Event e;
+          e.snapshot(s);
+          events.push(e);
+        }
+      }
+      else {
+        std::priority_queue <Event, std::vector<Event>, EventCompare> pending = events;
+        while (!pending.empty()) {
+          Event e = pending.top();
+          pending.pop();
+          e.snapshot(s);
+        }
+      }
+
+      s.check(trace != NULL, "source of processes");
+      if (trace != NULL) {
+        trace->snapshot(s);
+      }
+    }
+
+    /* to save a snapshot into the file fn; it is written under another name first, and then renamed, so
+       that a save that is cut short leaves the last one in place */
+    void save(const char* fn) {
+      std::string tmp = std::string(fn) + ".tmp";
+      Snapshot s;
+      s.fp = fopen(tmp.c_str(), "wb");
+      if (s.fp == NULL) {
+        printf("Error in opening file %s\n", tmp.c_str());
+        exit(1);
+      }
+      s.loading = 0;
+      snapshot(s);
+      if (ferror(s.fp) || fclose(s.fp) != 0 || rename(tmp.c_str(), fn) != 0) {
+        printf("Error in writing file %s\n", fn);
+        exit(1);
+      }
+    }
+
+    /* to pick up from the snapshot in the file fn, for a scheduler made with the same levels, CPUs, devices
+       and groups, reading from the same input file (or generator) */
+    void restore(const char* fn) {
+      Snapshot s;
+      s.fp = fopen(fn, "rb");
+      if (s.fp == NULL) {
+        printf("Error in opening file %s\n", fn);
+        exit(1);
+      }
+      s.loading = 1;
+      snapshot(s);
+      fclose(s.fp);
+    }
+
+    /* the number of processes that have finished */
+    long completed() const { return latency.count(); }
+
+    /* the number of processes waiting in the queues, and running on the CPUs */
+    long waiting() const { return queued; }
+    long running() const { return (long) cores.size() - idleCores; }
+
+    /* the mean turnaround time (ms) and throughput (processes/sec) of the processes that have finished */
+    double meanTat() const { return (completed() > 0) ? sumTat/completed() : 0; }
+    double throughput() const { return (makespan > 0) ? (completed()*1000.0)/makespan : 0; }
+};
+
+/* a process as it is run by the executor's worker threads */
+class ExecTask {
+  public:
+    int id;                     /* the process ID */
+    int initQueueLevel;         /* the level of the first queue the process was assigned to */
+    int currQueueLevel;         /* the level of the queue the process is currently in */
+    int burstTime;              /* the duration of the CPU burst left for the process */
+    double arrivalTime;         /* the wall clock time (ms) at which the process first joined a queue */
+    double enqueueTime;         /* the wall clock time (ms) at which the process last joined a queue */
+    double firstRunTime;        /* the wall clock time (ms) at which the process was first picked to run */
+    int serviceTime;            /* the duration of the whole CPU burst of the process */
+    double deadline;            /* the wall clock time (ms) by which the process should finish (INFINITY if none) */
+};
+
+/* the counters kept by each worker thread of the executor, padded so that workers don't share cache lines */
+class alignas(64) WorkerStats {
+  public:
+    long dispatches;            /* the number of times the worker picked a process to run */
+    long completions;           /* the number of processes the worker ran to the end of their burst */
+    double sumTat;              /* the sum of the TATs of those processes */
+    double lastFinish;          /* the wall clock time (ms) at which the last of those processes finished */
+    double sumLatency;          /* the sum of the times processes waited in a queue before being picked */
+    double maxLatency;          /* the longest time a process waited in a queue before being picked */
+    double busyTime;            /* the total time the worker spent running processes */
+    long casRetries;            /* the number of queue operations retried because another thread raced it */
+    long emptyPolls;            /* the number of times the worker found every queue empty */
+    LatencyStats latency;       /* the distributions of the latencies of the processes the worker finished */
+};
+
+/* runs the processes from the input file for real, on a pool of worker threads: the queue levels are
+   lock-free queues shared by all the workers, and each worker repeatedly takes a process from the highest
+   non-empty level and spins for its time slice / burst, without preemption (so SRTF levels are not
+   taken); the levels that order their processes (SJF, priority, EDF) are approximated by EXEC_BUCKETS
+   FIFO queues, for bursts in successive powers of 2 (or for the initial levels, for priority, or the time
+   left to the deadline, for EDF), taken in order, and CFS, lottery and stride levels are run as Round
+   Robin ones; processes are not aged, as a lock-free queue only gives access to its head */
+class Executor {
+  public:
+    int numLevels;                    /* the number of queue levels */
+    int quantum[MAX_LEVELS];          /* the time quantum of each level, if it is time-sliced */
+    int timeSliced[MAX_LEVELS];       /* whether each level is time-sliced */
+    int buckets[MAX_LEVELS];          /* the number of FIFO queues each level is made of */
+    int byPriority[MAX_LEVELS];       /* whether each level's queues are for initial levels, rather than bursts */
+    int byDeadline[MAX_LEVELS];       /* whether each level's queues are for the time left to deadlines */
+    std::vector <MPMCQueue <ExecTask*>> queues;   /* the FIFO queues, EXEC_BUCKETS to a level */
+
+    int numWorkers;                   /* the number of worker threads */
+    std::vector <WorkerStats> stats;  /* the counters of each worker */
+    std::atomic <long> outstanding;   /* the number of processes that have arrived and not yet finished */
+    std::atomic <int> arrivalsDone;   /* whether every process in the input file has arrived */
+    double start;                     /* the wall clock time (ms) at which the run started */
+    FILE* fp;                         /* the output logs file */
+    CompletionLog* log;               /* the log of the processes that finish */
+    long feederRetries;               /* the queue operations of the arrivals retried because a worker raced them */
+
+    Executor(const std::vector<AnyLevel>& lv, int workers, FILE* out, CompletionLog* cl) {
+      numLevels = lv.size();
+      int l;
+      for (l = 0; l < numLevels; l++) {
+        std::visit([&](auto& level) {
+          quantum[l] = level.quantum;
+          timeSliced[l] = level.timeSliced();
+          buckets[l] = (level.fifo() || level.timeSliced()) ? 1 : EXEC_BUCKETS;
+          byPriority[l] = strcmp(level.name(), "prio") == 0;
+          byDeadline[l] = strcmp(level.name(), "edf") == 0;
+        }, lv[l]);
+      }
+      queues = std::vector <MPMCQueue <ExecTask*>> (numLevels*EXEC_BUCKETS);
+      int b;
+      for (b = 0; b < numLevels*EXEC_BUCKETS; b++) {
+        queues[b].init(EXEC_MAX_INFLIGHT);
+      }
+      numWorkers = workers;
+      stats.resize(workers);
+      int w;
+      for (w = 0; w < workers; w++) {
+        stats[w].dispatches = 0;
+        stats[w].completions = 0;
+        stats[w].sumTat = 0;
+        stats[w].lastFinish = 0;
+        stats[w].sumLatency = 0;
+        stats[w].maxLatency = 0;
+        stats[w].busyTime = 0;
+        stats[w].casRetries = 0;
+        stats[w].emptyPolls = 0;
+        stats[w].latency.init(numLevels);
+      }
+      outstanding.store(0);
+      arrivalsDone.store(0);
+      fp = out;
+      log = cl;
+      feederRetries = 0;
+    }
+
+    /* to add a task to the queue of its current level (and bucket); there is always room, as a queue can
+       hold as many tasks as can be outstanding */
+    void push(ExecTask* t, long& retries) {
+      int l = t->currQueueLevel - 1;
+      int b = 0;
+      if (buckets[l] > 1) {
+        int key = byPriority[l] ? t->initQueueLevel : t->burstTime;
+        if (byDeadline[l]) {
+          double left = t->deadline - wallTime();
+          key = (left > (1 << 30)) ? (1 << 30) : (int) left;
+        }
+        b = (key <= 1) ? 0 : 32 - __builtin_clz(key - 1);
+        if (b >= buckets[l]) {
+          b = buckets[l] - 1;
+        }
+      }
+      t->enqueueTime = wallTime();
+      queues[l*EXEC_BUCKETS + b].push(t, retries);
+    }
+
+    /* to take a task from the highest non-empty level (and its lowest non-empty bucket) */
+    ExecTask* pop(long& retries) {
+      ExecTask* t;
+      int l, b;
+      for (l = 0; l < numLevels; l++) {
+        for (b = 0; b < buckets[l]; b++) {
+          if (queues[l*EXEC_BUCKETS + b].pop(t, retries)) {
+            return t;
+          }
+        }
+      }
+      return NULL;
+    }
+
+    /* to keep the CPU busy until the wall clock reaches the given time */
+    static void spinUntil(double t) {
+      volatile long x = 0;
+      while (wallTime() < t) {
+        x++;
+      }
+    }
+
+    /* the body of worker w */
+    void work(int w) {
+      WorkerStats& st = stats[w];
+      while (1) {
+        ExecTask* t = pop(st.casRetries);
+        if (t == NULL) {
+          if (arrivalsDone.load(std::memory_order_acquire) && outstanding.load(std::memory_order_acquire) == 0) {
+            break;
+          }
+          st.emptyPolls++;
+          sched_yield();
+          continue;
+        }
+        double now = wallTime();
+        double latency = now - t->enqueueTime;
+        st.dispatches++;
+        if (t->firstRunTime < 0) {
+          t->firstRunTime = now;
+        }
+        st.sumLatency += latency;
+        if (latency > st.maxLatency) {
+          st.maxLatency = latency;
+        }
+        int l = t->currQueueLevel - 1;
+        int slice = (timeSliced[l] && quantum[l] < t->burstTime) ? quantum[l] : t->burstTime;
+        /* the process runs on this worker's CPU until the end of its slice */
+        spinUntil(now + slice);
+        double end = wallTime();
+        st.busyTime += end - now;
+        t->burstTime -= slice;
+        if (t->burstTime > 0) {
+          push(t, st.casRetries);
+          continue;
+        }
+        double tat = end - t->arrivalTime;
+        CompletionRecord r;
+        r.id = t->id;
+        r.initQueueLevel = t->initQueueLevel;
+        r.currQueueLevel = t->currQueueLevel;
+        r.finishTime = end;
+        r.tat = tat;
+        log->log(r);
+        st.completions++;
+        st.sumTat += tat;
+        st.lastFinish = end;
+        st.latency.record(t->initQueueLevel, 0, tat - t->serviceTime, t->firstRunTime - t->arrivalTime, tat);
+        /* CFS, lottery and stride levels are run as Round Robin ones, so every process is entitled to the
+           same share */
+        st.latency.recordShare(t->initQueueLevel, 0, (tat > 0) ? t->serviceTime/tat : 1);
+        if (t->deadline != INFINITY) {
+          st.latency.recordDeadline(t->initQueueLevel, 0, end - t->deadline);
+        }
+        delete t;
+        outstanding.fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    /* to run every process in the input file, feeding each one to the queues at its arrival time, and
+       waiting for as long as EXEC_MAX_INFLIGHT processes are outstanding */
+    void run(ProcessSource* trace) {
+      start = wallTime();
+      std::vector <std::thread> workers;
+      int w;
+      for (w = 0; w < numWorkers; w++) {
+        workers.push_back(std::thread(&Executor::work, this, w));
+      }
+      Process p;
+      while (trace->next(p)) {
+        if (!p.phases.empty()) {
+          std::cout << "I/O requests are not supported in exec mode\n";
+          exit(0);
+        }
+        double d = start + p.arrivalTime - wallTime();
+        if (d > 0) {
+          usleep((useconds_t) (d*1000));
+        }
+        while (outstanding.load(std::memory_order_acquire) >= EXEC_MAX_INFLIGHT) {
+          sched_yield();
+        }
+        ExecTask* t = new ExecTask;
+        t->id = p.id;
+        t->initQueueLevel = p.initQueueLevel;
+        t->currQueueLevel = p.currQueueLevel;
+        t->burstTime = p.burstTime;
+        t->serviceTime = p.burstTime;
+        t->firstRunTime = -1;
+        t->arrivalTime = wallTime();
+        t->deadline = t->arrivalTime + (p.deadline - p.arrivalTime);
+        outstanding.fetch_add(1, std::memory_order_release);
+        push(t, feederRetries);
+      }
+      arrivalsDone.store(1, std::memory_order_release);
+      for (w = 0; w < numWorkers; w++) {
+        workers[w].join();
+      }
+    }
+
+    /* to print the mean TAT and throughput, and how long processes waited to be dispatched */
+    void report() {
+      long n = 0, dispatches = 0, retries = feederRetries, polls = 0;
+      double sumTat = 0, end = start, sumLatency = 0, maxLatency = 0;
+      int w;
+      for (w = 0; w < numWorkers; w++) {
+        n += stats[w].completions;
+        sumTat += stats[w].sumTat;
+        dispatches += stats[w].dispatches;
+        sumLatency += stats[w].sumLatency;
+        retries += stats[w].casRetries;
+        polls += stats[w].emptyPolls;
+        if (stats[w].lastFinish > end) {
+          end = stats[w].lastFinish;
+        }
+        if (stats[w].maxLatency > maxLatency) {
+          maxLatency = stats[w].maxLatency;
+        }
+      }
+      /* guarding against dividing by zero when no process ran, as the simulated report does */
+      double taken = (end > start) ? end - start : 1e-3;
+      double meanTat = (n > 0) ? sumTat/n : 0;
+      double meanLatency = (dispatches > 0) ? sumLatency/dispatches : 0;
+      fprintf(fp, "Mean Turnaround Time: %-5.2lf (ms); Throughput: %-5.2lf (processes/sec)\n", meanTat, (n*1000.0)/taken);
+      fprintf(stdout, "Mean Turnaround Time: %-5.2lf (ms); Throughput: %-5.2lf (processes/sec)\n", meanTat, (n*1000.0)/taken);
+      for (w = 0; w < numWorkers; w++) {
+        fprintf(fp, "Worker: %-4d; Utilisation: %6.2lf%%; Dispatches: %-7ld\n", w, (100.0*stats[w].busyTime)/taken, stats[w].dispatches);
+        fprintf(stdout, "Worker: %-4d; Utilisation: %6.2lf%%; Dispatches: %-7ld\n", w, (100.0*stats[w].busyTime)/taken, stats[w].dispatches);
+      }
+      LatencyStats all;
+      all.init(numLevels);
+      for (w = 0; w < numWorkers; w++) {
+        all.merge(stats[w].latency);
+      }
+      all.report(fp);
+      all.report(stdout);
+      fprintf(fp, "Dispatches: %ld; Mean Dispatch Latency(ms): %-5.3lf; Max Dispatch Latency(ms): %-5.3lf; CAS Retries: %ld; Empty Polls: %ld\n", dispatches, meanLatency, maxLatency, retries, polls);
+      fprintf(stdout, "Dispatches: %ld; Mean Dispatch Latency(ms): %-5.3lf; Max Dispatch Latency(ms): %-5.3lf; CAS Retries: %ld; Empty Polls: %ld\n", dispatches, meanLatency, maxLatency, retries, polls);
+    }
+};
+
+/* to create the queue levels from a comma-separated list of policy names (rr, fcfs, sjf, srtf, prio, edf, cfs,
+   lottery, stride), from the highest level to the lowest, each optionally followed by :quantum to override
+   the default time quantum */
+inline std::vector <AnyLevel> parseLevels(const char* spec, int defaultQuantum) {
+  std::vector <AnyLevel> lv;
+  char* buf = strdup(spec);
+  char* save;
+  char* tok = strtok_r(buf, ",", &save);
+  while (tok != NULL) {
+    int quantum = defaultQuantum;
+    char* colon = strchr(tok, ':');
+    if (colon != NULL) {
+      *colon = '\0';
+      quantum = atoi(colon + 1);
+      if (quantum <= 0) {
+        std::cout << "Expected a positive time quantum for level " << lv.size() + 1 << ", but received " << colon + 1 << "\n";
+        exit(0);
+      }
+    }
+    AnyLevel level;
+    if (!makeLevel(tok, quantum, level)) {
+      std::cout << "Expected level policy to be one of rr, fcfs, sjf, srtf, prio, edf, cfs, lottery, stride, but received " << tok << "\n";
+      exit(0);
+    }
+    lv.push_back(level);
+    tok = strtok_r(NULL, ",", &save);
+  }
+  free(buf);
+  if (lv.empty() || lv.size() > MAX_LEVELS) {
+    std::cout << "Expected between 1 and " << MAX_LEVELS << " queue levels, but received " << lv.size() << "\n";
+    exit(0);
+  }
+  return lv;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#!/bin/sh
+# the regression tests of the scheduler: each test simulates a small input file (NAME.txt) with the given
+# options, and checks that the processes finish in the order and at the times in NAME.expected
+
+cd "$(dirname "$0")"
+g++ -O2 -pthread -o scheduling ../scheduling.cpp || exit 1
+failed=0
+
+# to run the test NAME with the options that follow it
+check() {
+  name=$1
+  shift
+  rm -f "$name.out"
+  ./scheduling -F "$name.txt" -P "$name.out" "$@" > /dev/null
+  if grep "^ID" "$name.out" | diff "$name.expected" - > /dev/null; then
+    echo "PASS $name"
+  else
+    echo "FAIL $name"
+    grep "^ID" "$name.out" | diff "$name.expected" -
+    failed=1
+  fi
+  rm -f "$name.out"
+}
+
+# a process preempted from an FCFS level goes back ahead of the one that joined the level after it
+check preempt-fifo -Q 10 -T 200 -M sim -R 1
+
+# in preemptive mode, a process is upgraded as soon as it is due, and the upgrade preempts the long burst of
+# the lower level running
+check aging-preempt -Q 10 -T 100 -M sim -R 1
+
+# with groups, an FCFS process runs to the end of its burst while no other group has work, and one stopped
+# for another group goes back ahead of the processes of its own group that joined after it
+check group-alone -Q 10 -T 200 -M sim -L fcfs -H other=1
+check group-slice -Q 10 -T 200 -M sim -L fcfs -H other=1
+
+rm -f scheduling
+exit $failed